@@ -23,6 +23,68 @@
 
 #define ADC_CHANNEL_AUX_ANALOG 0
 
+/*
+ * ADC sampling, free running (src/sampler)
+ *
+ * ADC_CHANNELS is a mask of 1, 2 or 4 channels. ADC3 reads VSYS/3 on the
+ * Pico 2 W, but GPIO29 is also the wireless chip's SPI clock, so it can't
+ * be sampled while the radio is up. ADC_SAMPLE_HZ is for all the channels
+ * together, up to 500 kHz. Readings add up the last ADC_OVERSAMPLE samples
+ * of a channel.
+ */
+#define ADC_CHANNELS   (1 << ADC_CHANNEL_AUX_ANALOG)
+#define ADC_SAMPLE_HZ  40000
+#define ADC_OVERSAMPLE 16
+
+// Timer callback period
+#define TICK_PERIOD_US 1000
+
+/*
+ * Timer callback budget
+ *
+ * Sheddable tasks (LED, aux analog) are put off while a tick is past this,
+ * at most TICK_SHED_MAX ticks in a row. The motor and command dispatch
+ * always run.
+ */
+#define TICK_BUDGET_US 300
+#define TICK_SHED_MAX  20
+
+/*
+ * Digital inputs (buttons, aux detect, motor fault)
+ *
+ * With DIGITAL_EDGE_IRQ, edges come from GPIO interrupts, timestamped to
+ * the us, instead of polling each pin once per tick, and an aux press is
+ * pulsed from the interrupt rather than at the next tick. Up to
+ * DIGITAL_EDGE_RING_SIZE edges (a power of two) wait per pin to be taken.
+ */
+#define DIGITAL_EDGE_IRQ       true
+#define DIGITAL_EDGE_RING_SIZE 16
+
+/*
+ * Debounce, per input (digital.h): DIGITAL_DEBOUNCE_NONE, _LOCKOUT,
+ * _INTEGRATOR or _VERTICAL. Lockout reacts on the first edge, the others
+ * a few ticks after the switch settles. The motor fault isn't debounced.
+ */
+#define DIGITAL_DEBOUNCE_PAIR       DIGITAL_DEBOUNCE_INTEGRATOR
+#define DIGITAL_DEBOUNCE_AUX_DETECT DIGITAL_DEBOUNCE_VERTICAL
+#define DIGITAL_DEBOUNCE_AUX_BUTTON DIGITAL_DEBOUNCE_LOCKOUT
+#define DIGITAL_LOCKOUT_US          20000
+#define DIGITAL_INTEGRATOR_TICKS    5
+
+/*
+ * Button gestures (src/gesture)
+ *
+ * Held GESTURE_LONG_MS is a long press, then it repeats every
+ * GESTURE_REPEAT_MS. A second click within GESTURE_DOUBLE_MS of the first
+ * makes a double. A double click on the pair button drops the Bluetooth
+ * connection, holding it PAIR_FORGET_MS forgets the paired hosts too.
+ */
+#define GESTURE_LONG_MS    500
+#define GESTURE_DOUBLE_MS  300
+#define GESTURE_REPEAT_MS  200
+#define GESTURE_QUEUE_SIZE 8
+#define PAIR_FORGET_MS     3000
+
 /*
  * PRINTF
  *
@@ -30,8 +92,140 @@
  */
 #define PRINTF printf
 
-#define ANALOG_AVERAGING_WINDOW 64
+/*
+ * ANALOG_FILTER
+ *
+ * Per analog input, on one reading per tick:
+ *   ANALOG_FILTER_EMA     one pole, time constant 2^ANALOG_EMA_SHIFT ticks
+ *   ANALOG_FILTER_BIQUAD  2nd order low-pass at ANALOG_LOWPASS_HZ
+ * With ANALOG_MEDIAN, a median of 3 drops spikes first (one tick later).
+ */
+#define ANALOG_FILTER     ANALOG_FILTER_EMA
+#define ANALOG_EMA_SHIFT  3
+#define ANALOG_LOWPASS_HZ 30
+#define ANALOG_MEDIAN     true
+
+// Velocity and acceleration of the analog inputs, over about this many ticks
+#define ANALOG_TRACKER_TICKS 16
+
+/*
+ * Aux knob movement detection (src/movement)
+ *
+ * The slope is filtered by 2^MOVEMENT_SLOPE_SHIFT readings, the noise
+ * floor learnt over 2^MOVEMENT_NOISE_SHIFT, which is also how many readings
+ * it settles for, without firing, after a reset. MOVEMENT_DRIFT and
+ * MOVEMENT_THRESHOLD are multiples of the noise floor: the slope ignored
+ * per reading, and how far the sum of the rest has to get. The floor
+ * doesn't go below MOVEMENT_NOISE_MIN, in 1/16 ADC counts per reading.
+ */
+#define MOVEMENT_SLOPE_SHIFT 3
+#define MOVEMENT_NOISE_SHIFT 8
+#define MOVEMENT_NOISE_MIN   2
+#define MOVEMENT_DRIFT       2
+#define MOVEMENT_THRESHOLD   40
+#define MOVEMENT_QUIET_TICKS 50
+
+/*
+ * Aux knob detents (src/knob)
+ *
+ * With KNOB_ENABLED, the aux knob clicks like a notched encoder instead of
+ * pulsing when it moves. KNOB_DETENTS evenly spaced between the walls, or
+ * the filtered ADC readings in KNOB_DETENT_POSITIONS (ascending) if it is
+ * defined. A detent is crossed KNOB_HYSTERESIS past it. Below KNOB_WALL_LOW
+ * or above KNOB_WALL_HIGH the knob buzzes, every KNOB_WALL_REPEAT_MS.
+ * Clicks are as strong as the turn is fast, see AUX_PULSE_MS below.
+ * Off by default: it replaces the movement pulses.
+ */
+#define KNOB_ENABLED        false
+#define KNOB_DETENTS        12
+//#define KNOB_DETENT_POSITIONS { 600, 1200, 2048, 2900, 3500 }
+#define KNOB_HYSTERESIS     24
+#define KNOB_WALL_LOW       100
+#define KNOB_WALL_HIGH      3995
+#define KNOB_WALL_REPEAT_MS 150
+#define KNOB_WALL_MS        40
+
+/*
+ * Aux knob pulse intensity (src/intensity)
+ *
+ * Knob clicks and movement pulses scale with the turning speed, in ADC
+ * counts per second: AUX_PULSE_MS_MIN at AUX_PWM_MIN up to AUX_SPEED_MIN,
+ * linearly up to AUX_PULSE_MS_MAX at AUX_PWM_MAX from AUX_SPEED_MAX. While
+ * it speeds up, the speed AUX_LEAD_MS later is used. The motor runs at most
+ * AUX_DUTY_PERCENT of the time over AUX_DUTY_WINDOW_MS.
+ */
+#define AUX_SPEED_MIN      300
+#define AUX_SPEED_MAX      6000
+#define AUX_PULSE_MS_MIN   8
+#define AUX_PULSE_MS_MAX   25
+#define AUX_PWM_MIN        150
+#define AUX_PWM_MAX        255
+#define AUX_LEAD_MS        20
+#define AUX_DUTY_PERCENT   40
+#define AUX_DUTY_WINDOW_MS 500
+
+/*
+ * STATIC_DEVICES
+ *
+ * Command links and their detents come from arrays in .bss sized here,
+ * instead of the heap. Memory use is known at link time, and a pool too
+ * small panics at boot. The bracelet's own devices (LED, inputs, motor,
+ * aux) are embedded in struct bracelet_t, in main.c.
+ */
+#define STATIC_DEVICES       true
+#define STATIC_COMMAND_LINKS 2	// RFCOMM, USB
+#define STATIC_DETENTS       2	// one per command link
+
+// Pending pulses per command link (RFCOMM, USB)
+#define COMMAND_QUEUE_SIZE 8
+
+// Pending pulses scheduled at a device time, per command link
+#define COMMAND_SCHEDULE_SIZE 4
+
+// Pulse acks waiting for the transport, per command link
+#define COMMAND_ACK_SIZE 8
+
+// Detents streamed by the host ("d <spacing> <position>")
+#define DETENT_PULSE_MS    10
+#define DETENT_PENDING_MAX 2	// clicks owed after a fast drag, more are dropped
+
+/*
+ * Event log
+ *
+ * Reserved at the end of flash, right below the BTstack pairing keys
+ * (PICO_FLASH_BANK_TOTAL_SIZE). The firmware image has to stay below it.
+ * Multiple of the flash sector size (4096).
+ */
+#define EVENTLOG_FLASH_SIZE        (256 * 1024)
+#define EVENTLOG_RAM_PAGES         4	// 256 byte pages waiting to be written
+#define EVENTLOG_FLASH_TIMEOUT_MS  100
+
+// LOG(): entries per context (thread, lowest, default, other IRQs)
+#define LOG_RING_SIZE 32
+#define LOG_LINE_MAX  128
+
+/*
+ * LOG_TOKENIZED
+ *
+ * Send LOG() lines as tokens, read them with host/tools/haptic_detok.cpp.
+ * Format strings stay out of flash, lines are a few bytes each.
+ */
+#define LOG_TOKENIZED false
 
-#define MEASURE_CALLBACK_TIME false
+/*
+ * Trace ("r" command, host/tools/haptic_trace.cpp)
+ *
+ * Records in RAM, 8 bytes each, a power of two.
+ */
+#define TRACE_ENABLED   true
+#define TRACE_RING_SIZE 1024
+
+/*
+ * Timing histograms ("t" command)
+ *
+ * A tick taking longer than this, or starting this far off its period, is
+ * counted as an overrun. Tasks have their own budgets, in main.c.
+ */
+#define TIMING_OVERRUN_US 500
 
 #endif /* HAPTIC_BRACELET_CONFIG_H */
\ No newline at end of file
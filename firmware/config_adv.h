@@ -29,8 +29,118 @@ static inline us_t us_now()
 	return to_us_since_boot(get_absolute_time());
 }
 
-#if ANALOG_AVERAGING_WINDOW < 1
-#error ANALOG_AVERAGING_WINDOW must be >= 1
+#if ADC_CHANNELS == 0 || (ADC_CHANNELS & ~0xf) != 0
+#error ADC_CHANNELS must be a mask of ADC0 to ADC3
+#endif
+
+#if ADC_SAMPLE_HZ < 1000 || ADC_SAMPLE_HZ > 500000
+#error ADC_SAMPLE_HZ must be between 1000 and 500000
+#endif
+
+#if ADC_OVERSAMPLE < 1
+#error ADC_OVERSAMPLE must be >= 1
+#endif
+
+#define ANALOG_FILTER_EMA    1
+#define ANALOG_FILTER_BIQUAD 2
+
+#if ANALOG_FILTER != ANALOG_FILTER_EMA && ANALOG_FILTER != ANALOG_FILTER_BIQUAD
+#error ANALOG_FILTER must be ANALOG_FILTER_EMA or ANALOG_FILTER_BIQUAD
+#endif
+
+#if ANALOG_EMA_SHIFT < 0 || ANALOG_EMA_SHIFT > 16
+#error ANALOG_EMA_SHIFT must be between 0 and 16
+#endif
+
+#if ANALOG_LOWPASS_HZ < 1 || ANALOG_LOWPASS_HZ * 2 >= 1000000 / TICK_PERIOD_US
+#error ANALOG_LOWPASS_HZ must be between 1 and half the tick rate
+#endif
+
+#if ANALOG_TRACKER_TICKS < 2
+#error ANALOG_TRACKER_TICKS must be >= 2
+#endif
+
+#if AUX_SPEED_MIN >= AUX_SPEED_MAX || AUX_PULSE_MS_MIN > AUX_PULSE_MS_MAX || AUX_PWM_MIN > AUX_PWM_MAX
+#error AUX_SPEED, AUX_PULSE_MS and AUX_PWM must go from MIN to MAX
+#endif
+
+#if AUX_PWM_MAX > 255
+#error AUX_PWM_MAX must be <= 255
+#endif
+
+#if AUX_DUTY_PERCENT < 1 || AUX_DUTY_PERCENT > 100
+#error AUX_DUTY_PERCENT must be between 1 and 100
+#endif
+
+#if MOVEMENT_SLOPE_SHIFT < 1 || MOVEMENT_NOISE_SHIFT < 1
+#error MOVEMENT_SLOPE_SHIFT and MOVEMENT_NOISE_SHIFT must be >= 1
+#endif
+
+#define KNOB_DETENTS_MAX 32
+
+#if KNOB_DETENTS < 1 || KNOB_DETENTS > KNOB_DETENTS_MAX
+#error KNOB_DETENTS must be between 1 and KNOB_DETENTS_MAX
+#endif
+
+#if KNOB_WALL_LOW < 0 || KNOB_WALL_HIGH > ADC_MAX || KNOB_WALL_LOW >= KNOB_WALL_HIGH
+#error KNOB_WALL_LOW and KNOB_WALL_HIGH must be ascending, within the ADC range
+#endif
+
+#if KNOB_HYSTERESIS < 0
+#error KNOB_HYSTERESIS must be >= 0
+#endif
+
+#if COMMAND_QUEUE_SIZE < 2
+#error COMMAND_QUEUE_SIZE must be >= 2
+#endif
+
+#if COMMAND_ACK_SIZE < 2
+#error COMMAND_ACK_SIZE must be >= 2
+#endif
+
+#if EVENTLOG_FLASH_SIZE % 4096 != 0 || EVENTLOG_FLASH_SIZE == 0
+#error EVENTLOG_FLASH_SIZE must be a non zero multiple of 4096
+#endif
+
+#if EVENTLOG_RAM_PAGES < 2
+#error EVENTLOG_RAM_PAGES must be >= 2
+#endif
+
+#if TICK_PERIOD_US < 100
+#error TICK_PERIOD_US must be >= 100
+#endif
+
+#if TICK_BUDGET_US >= TICK_PERIOD_US
+#error TICK_BUDGET_US must be < TICK_PERIOD_US
+#endif
+
+#define DIGITAL_DEBOUNCE_NONE       0
+#define DIGITAL_DEBOUNCE_LOCKOUT    1
+#define DIGITAL_DEBOUNCE_INTEGRATOR 2
+#define DIGITAL_DEBOUNCE_VERTICAL   3
+
+#if DIGITAL_INTEGRATOR_TICKS < 1 || DIGITAL_INTEGRATOR_TICKS > 255
+#error DIGITAL_INTEGRATOR_TICKS must be between 1 and 255
+#endif
+
+#if GESTURE_REPEAT_MS < 1 || GESTURE_QUEUE_SIZE < 2
+#error GESTURE_REPEAT_MS must be >= 1, GESTURE_QUEUE_SIZE >= 2
+#endif
+
+#if PAIR_FORGET_MS < GESTURE_LONG_MS
+#error PAIR_FORGET_MS must be >= GESTURE_LONG_MS
+#endif
+
+#if DIGITAL_EDGE_RING_SIZE < 2 || (DIGITAL_EDGE_RING_SIZE & (DIGITAL_EDGE_RING_SIZE - 1)) != 0
+#error DIGITAL_EDGE_RING_SIZE must be a power of two
+#endif
+
+#if TRACE_RING_SIZE < 2 || (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) != 0
+#error TRACE_RING_SIZE must be a power of two
+#endif
+
+#if LOG_RING_SIZE < 2
+#error LOG_RING_SIZE must be >= 2
 #endif
 
 #endif /* HAPTIC_BRACELET_CONFIG_ADV_H */
\ No newline at end of file
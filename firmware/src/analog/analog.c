@@ -5,120 +5,131 @@
  */
 
 #include <stdlib.h>
-#include "hardware/adc.h"
 #include "hardware/gpio.h"
 #include "pico/stdlib.h"
-#include "pico/malloc.h"
 
 #include "config.h"
 #include "config_adv.h"
 #include "analog.h"
+#include "filter.h"
+#include "movement.h"
+#include "sampler.h"
 
-enum analog_prev {ap_low, ap_high, ap_size};
-
-struct analog_t {
-	uint pin;
-	uint adc_id;
-
-	volatile adc_t    _Atomic raw_values[ANALOG_AVERAGING_WINDOW];
-	volatile size_t   _Atomic last_written;
-	volatile uint32_t _Atomic avg_sum;
-
-	volatile adc_t _Atomic prev[ap_size];
-
-	volatile ms_t _Atomic activation1_time;
-	bool           activation2_consumed;
-	// External
-};
-
-static inline void analog_read(struct analog_t *ptr)
+// Q16 per tick to per second, per second squared
+static inline int32_t analog_per_second(int32_t value, int order)
 {
-	adc_select_input(ptr->adc_id);
-	adc_t value = adc_read();
-
-	size_t i = ptr->last_written;
-	size_t i_next = 0;
-	if (i < ANALOG_AVERAGING_WINDOW - 1)
-		i_next = i + 1;
-
-	ptr->avg_sum -= ptr->raw_values[i_next];
-	ptr->raw_values[i_next] = value;
-	ptr->avg_sum += value;
-	ptr->last_written = i_next;
+	int64_t result = value;
+	while (order-- > 0)
+		result *= 1000000 / TICK_PERIOD_US;
+
+	result >>= FILTER_TRACKER_FRACTION;
+	if (result > INT32_MAX)
+		return INT32_MAX;
+	if (result < INT32_MIN)
+		return INT32_MIN;
+	return result;
 }
 
-static inline adc_t analog_avg_now(struct analog_t *ptr)
+static inline void analog_read(struct analog_t *ptr)
 {
-	return (ptr->avg_sum / ANALOG_AVERAGING_WINDOW);
+	int32_t value = sampler_read(ptr->adc_id);
+
+#if ANALOG_MEDIAN
+	value = filter_median3(&(ptr->median), value);
+#endif
+	// Before the low-pass, it would only delay these
+	filter_tracker(&(ptr->tracker), value);
+	ptr->velocity     = analog_per_second(filter_tracker_velocity(&(ptr->tracker)), 1);
+	ptr->acceleration = analog_per_second(filter_tracker_acceleration(&(ptr->tracker)), 2);
+
+	if (movement_update(&(ptr->movement), value, &(ptr->event)))
+		ptr->event_pending = true;
+
+#if ANALOG_FILTER == ANALOG_FILTER_EMA
+	value = filter_ema(&(ptr->ema), value);
+#else
+	value = filter_biquad(&(ptr->biquad), value);
+#endif
+
+	// The biquad can overshoot a little
+	if (value < 0)
+		value = 0;
+	if (value > ADC_MAX)
+		value = ADC_MAX;
+	ptr->filtered = value;
 }
 
-static inline void analog_reset(struct analog_t *ptr)
+static inline adc_t analog_avg_now(struct analog_t *ptr)
 {
-	adc_t now = analog_avg_now(ptr);
-
-	ptr->prev[ap_low]  = now;
-	ptr->prev[ap_high] = now;
+	return ptr->filtered;
 }
 
-void analog_new(struct analog_t **ptr, uint pin, uint adc_id)
+void analog_init(struct analog_t *ptr, uint pin, uint adc_id)
 {
-	// TODO error check ptr
-	struct analog_t *new = malloc(sizeof(struct analog_t));
-	if (new == NULL) {
-		// error
-	}
-
-	new->pin = pin;
-	adc_gpio_init(new->pin);
+	// The sampler owns the ADC and its pins
+	ptr->pin = pin;
 
-	new->adc_id = adc_id;
+	ptr->adc_id = adc_id;
 
-	new->avg_sum = 0;
-	for (size_t i = 0; i < ANALOG_AVERAGING_WINDOW; i++) {
-		new->raw_values[i] = 0;
-		new->last_written = i;
-	}
-
-	for (size_t i = 0; i < ANALOG_AVERAGING_WINDOW; i++)
-		analog_read(new);
-
-	analog_reset(new);
+	// Start settled on the current value
+	analog_reset(ptr);
 
-	new->activation1_time     = 0;
-	new->activation2_consumed = true;
-	*ptr = new;
+	ptr->activation1_time     = 0;
+	ptr->activation2_consumed = true;
 }
 
-void analog_free(struct analog_t *ptr)
+void analog_reset(struct analog_t *ptr)
 {
-	free(ptr);
+	adc_t value = sampler_read(ptr->adc_id);
+#if ANALOG_MEDIAN
+	filter_median3_init(&(ptr->median), value);
+#endif
+#if ANALOG_FILTER == ANALOG_FILTER_EMA
+	filter_ema_init(&(ptr->ema), ANALOG_EMA_SHIFT, value);
+#else
+	filter_biquad_lowpass(&(ptr->biquad), ANALOG_LOWPASS_HZ, 1000000 / TICK_PERIOD_US, value);
+#endif
+	ptr->filtered = value;
+
+	filter_tracker_init(&(ptr->tracker), ANALOG_TRACKER_TICKS, value);
+	ptr->velocity     = 0;
+	ptr->acceleration = 0;
+
+	movement_init(&(ptr->movement), value);
+	ptr->event_pending = false;
 }
 
 void analog_update(struct analog_t *ptr)
 {
 	analog_read(ptr);
-	adc_t now = analog_avg_now(ptr);
-
-	if (now < ptr->prev[ap_low])
-		ptr->prev[ap_low] = now;
+}
 
-	if (now > ptr->prev[ap_high])
-		ptr->prev[ap_high] = now;
+adc_t analog_now(struct analog_t *ptr)
+{
+	return analog_avg_now(ptr);
 }
 
-bool analog_active(struct analog_t *ptr, adc_t threshold_percent)
+int32_t analog_velocity(struct analog_t *ptr)
 {
-	// Cap the input
-	if (threshold_percent > 100)
-		threshold_percent = 100;
+	return ptr->velocity;
+}
 
-	adc_t current = ptr->prev[ap_high] - ptr->prev[ap_low];
+int32_t analog_acceleration(struct analog_t *ptr)
+{
+	return ptr->acceleration;
+}
 
-	if ((current / ADC_PERCENT) < threshold_percent)
+bool analog_moved(struct analog_t *ptr, struct movement_event_t *event)
+{
+	if (!ptr->event_pending)
 		return false;
 
-	analog_reset(ptr);
-	ptr->activation1_time = ms_now();
+	ptr->event_pending = false;
+	if (event != NULL)
+		*event = ptr->event;
+
+	ptr->activation1_time     = ms_now();
+	ptr->activation2_consumed = false;
 
 	return true;
 }
@@ -8,18 +8,78 @@
 #define HAPTIC_BRACELET_FIRMWARE_ANALOG_H
 
 #include "config_adv.h"
+#include "filter.h"
+#include "movement.h"
 
-struct analog_t;
+/*
+ * struct analog_t:
+ *
+ * An ADC input, read from the sampler once per tick, filtered, tracked
+ * and watched for movement. Embedded in the owner, only touched by the
+ * timer callback once set up.
+ */
+struct analog_t {
+	uint pin;
+	uint adc_id;
+
+#if ANALOG_MEDIAN
+	struct filter_median3_t median;
+#endif
+#if ANALOG_FILTER == ANALOG_FILTER_EMA
+	struct filter_ema_t ema;
+#else
+	struct filter_biquad_t biquad;
+#endif
+	adc_t filtered;
+
+	struct filter_tracker_t tracker;
+	int32_t velocity;
+	int32_t acceleration;
 
-void analog_new(struct analog_t **ptr, uint pin, uint adc_id);
+	struct movement_t       movement;
+	struct movement_event_t event;
+	bool                    event_pending;
+
+	ms_t           activation1_time;
+	bool           activation2_consumed;
+	// External
+};
+
+void analog_init(struct analog_t *ptr, uint pin, uint adc_id);
 void analog_update(struct analog_t *ptr);
 
-bool analog_active(struct analog_t *ptr, adc_t threshold_percent);
+/*
+ * analog_reset:
+ *
+ * Start over settled on the current reading, still, after the input was
+ * disconnected. Nothing pending.
+ */
+void analog_reset(struct analog_t *ptr);
+
+// Filtered reading (ANALOG_FILTER)
+adc_t analog_now(struct analog_t *ptr);
+
+/*
+ * analog_velocity, analog_acceleration:
+ *
+ * Rate of change, ADC counts per second (squared), signed. Tracked on
+ * the median filtered reading (filter_tracker_t, ANALOG_TRACKER_TICKS).
+ */
+int32_t analog_velocity(struct analog_t *ptr);
+int32_t analog_acceleration(struct analog_t *ptr);
+
+/*
+ * analog_moved:
+ *
+ * The input started moving, or reversed, since the last call (see
+ * movement.h). event, if not NULL, tells which way and how far.
+ */
+bool analog_moved(struct analog_t *ptr, struct movement_event_t *event);
 
 /*
  * analog_active2:
  * 
- * Second activation, delta ms after the first.
+ * Second activation, delta ms after analog_moved().
  */
 bool analog_active2(struct analog_t *ptr, ms_t delta);
 
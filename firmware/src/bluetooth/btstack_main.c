@@ -50,6 +50,7 @@
 // *****************************************************************************
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -64,13 +65,12 @@
 #include "config_adv.h"
 
 #include "npf_interface.h"
+#include "command.h"
+#include "counter.h"
+#include "log.h"
+#include "trace.h"
 #include "btstack_main.h"
 
-static inline void print_timestamp()
-{
-	PRINTF("[%8ju] ", (uintmax_t)ms_now());
-}
-
 struct bt_data_t *bt_data = NULL;
 
 #define RFCOMM_SERVER_CHANNEL 1
@@ -78,7 +78,14 @@ struct bt_data_t *bt_data = NULL;
 
 static void packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
 
+static hci_con_handle_t connection_handle = HCI_CON_HANDLE_INVALID;
+
+// bluetooth_disconnect(), from any context
+static volatile bool _Atomic disconnect_requested = false;
+static volatile bool _Atomic forget_requested = false;
+
 static uint16_t rfcomm_channel_id;
+static uint16_t rfcomm_mtu;
 static uint8_t  spp_service_buffer[150];
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
@@ -100,8 +107,7 @@ static btstack_packet_callback_registration_t hci_event_callback_registration;
 /* LISTING_START(SPPSetup): SPP service setup */ 
 static void spp_service_setup(void)
 {
-	print_timestamp();
-	PRINTF("Reached bluetooth_setup()\n");
+	LOG("Reached bluetooth_setup()\n");
 
 	l2cap_init();
 
@@ -128,6 +134,119 @@ static void spp_service_setup(void)
 }
 /* LISTING_END */
 
+/* @section Replies
+ *
+ * @text Replies to commands are queued here and sent on RFCOMM_EVENT_CAN_SEND_NOW,
+ * at most one frame at a time.
+ */
+#define TX_BUFFER_SIZE 1024
+
+static uint8_t tx_buffer[TX_BUFFER_SIZE];
+static size_t  tx_head = 0;
+static size_t  tx_tail = 0;
+
+void bluetooth_reply(const char *data, size_t size)
+{
+	if (rfcomm_channel_id == 0)
+		return;
+
+	for (size_t i = 0; i < size; i++) {
+		size_t head_next = (tx_head + 1) % TX_BUFFER_SIZE;
+		if (head_next == tx_tail) {
+			// full, drop the rest
+			counter_add(counter_reply_bytes_dropped, size - i);
+			break;
+		}
+
+		tx_buffer[tx_head] = data[i];
+		tx_head = head_next;
+	}
+	rfcomm_request_can_send_now_event(rfcomm_channel_id);
+}
+
+// Bulk data from the commands, into whatever room the ring has
+static void bluetooth_pull(void)
+{
+	size_t used = (tx_head + TX_BUFFER_SIZE - tx_tail) % TX_BUFFER_SIZE;
+	size_t space = TX_BUFFER_SIZE - 1 - used;
+
+	uint8_t buffer[256];
+	size_t length = command_read(bt_data->commands, buffer, space < sizeof(buffer) ? space : sizeof(buffer));
+	if (length > 0)
+		bluetooth_reply((const char *)buffer, length);
+}
+
+static void bluetooth_send(void)
+{
+	if (tx_head == tx_tail)
+		return;
+
+	// Contiguous part only, the rest goes in the next frame
+	size_t length = (tx_head > tx_tail) ? tx_head - tx_tail : TX_BUFFER_SIZE - tx_tail;
+	if (length > rfcomm_mtu)
+		length = rfcomm_mtu;
+
+	if (rfcomm_send(rfcomm_channel_id, &tx_buffer[tx_tail], length) != ERROR_CODE_SUCCESS)
+		return;
+
+	tx_tail = (tx_tail + length) % TX_BUFFER_SIZE;
+
+	// Keep a download going at link speed
+	bluetooth_pull();
+	if (tx_head != tx_tail)
+		rfcomm_request_can_send_now_event(rfcomm_channel_id);
+}
+
+static void bluetooth_count_disconnect(uint8_t reason)
+{
+	counter_increment(counter_bt_disconnects);
+	counter_set(counter_bt_disconnect_reason, reason);
+
+	switch (reason) {
+		case ERROR_CODE_CONNECTION_TIMEOUT:
+			counter_increment(counter_bt_disconnect_timeout);
+			break;
+
+		case ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION:
+			counter_increment(counter_bt_disconnect_remote);
+			break;
+
+		case ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST:
+			counter_increment(counter_bt_disconnect_local);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void bluetooth_disconnect(bool forget)
+{
+	if (forget)
+		forget_requested = true;
+	disconnect_requested = true;
+}
+
+static void bluetooth_drop(void)
+{
+	if (!atomic_exchange(&disconnect_requested, false))
+		return;
+
+	if (atomic_exchange(&forget_requested, false)) {
+		LOG("Forgetting paired hosts\n");
+		gap_delete_all_link_keys();
+#ifdef ENABLE_BLE
+		for (int i = 0; i < le_device_db_max_count(); i++)
+			le_device_db_remove(i);
+#endif
+	}
+
+	if (connection_handle != HCI_CON_HANDLE_INVALID) {
+		LOG("Disconnecting\n");
+		gap_disconnect(connection_handle);
+	}
+}
+
 /* @section Periodic Timer Setup
  * 
  * @text The heartbeat handler increases the real counter every second, 
@@ -137,6 +256,14 @@ static void spp_service_setup(void)
 /* LISTING_START(PeriodicCounter): Periodic Counter */ 
 static btstack_timer_source_t heartbeat;
 static void  heartbeat_handler(struct btstack_timer_source *ts){
+	bluetooth_drop();
+
+	// Pulse acks from the timer callback, bulk data
+	if (rfcomm_channel_id != 0) {
+		command_service(bt_data->commands);
+		bluetooth_pull();
+	}
+
 	btstack_run_loop_set_timer(ts, HEARTBEAT_PERIOD_MS);
 	btstack_run_loop_add_timer(ts);
 } 
@@ -192,77 +319,87 @@ static void one_shot_timer_setup(void){
 static void packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
 	UNUSED(channel);
 
+	uint16_t trace_value = packet_type << 8;
+	if (packet_type == HCI_EVENT_PACKET)
+		trace_value |= hci_event_packet_get_type(packet);
+	trace_begin(trace_packet, trace_value);
+
 	bd_addr_t event_addr;
 	uint8_t   rfcomm_channel_nr;
 	uint16_t  mtu;
-	int i;
 
 	switch (packet_type) {
 		case HCI_EVENT_PACKET:
 		switch (hci_event_packet_get_type(packet)) {
 			case HCI_EVENT_PIN_CODE_REQUEST:
 				// inform about pin code request
-				printf("Pin code request - using '0000'\n");
+				LOG("Pin code request - using '0000'\n");
 				hci_event_pin_code_request_get_bd_addr(packet, event_addr);
 				gap_pin_code_response(event_addr, "0000");
 				break;
 
 			case HCI_EVENT_CONNECTION_COMPLETE:
-				PRINTF("Connected\n");
-				bt_data->connected = true;
+				LOG("Connected\n");
+				counter_increment(counter_bt_connects);
+				connection_handle = hci_event_connection_complete_get_connection_handle(packet);
+				atomic_store_explicit(&(bt_data->connected), true, memory_order_relaxed);
 				break;
 
 			case HCI_EVENT_DISCONNECTION_COMPLETE:
 				//PRINTF("Disconnected\n");
-				PRINTF("Disconnect, reason 0x%02x\n", hci_event_disconnection_complete_get_reason(packet));
+				LOG("Disconnect, reason 0x%02x\n", hci_event_disconnection_complete_get_reason(packet));
+				bluetooth_count_disconnect(hci_event_disconnection_complete_get_reason(packet));
 
-				bt_data->connected = false;
+				connection_handle = HCI_CON_HANDLE_INVALID;
+				atomic_store_explicit(&(bt_data->connected), false, memory_order_relaxed);
 				break;
 
 			case HCI_EVENT_USER_CONFIRMATION_REQUEST:
 				// ssp: inform about user confirmation request
-				printf("SSP User Confirmation Request with numeric value '%06"PRIu32"'\n", little_endian_read_32(packet, 8));
-				printf("SSP User Confirmation Auto accept\n");
+				LOG("SSP User Confirmation Request with numeric value '%06"PRIu32"'\n", little_endian_read_32(packet, 8));
+				LOG("SSP User Confirmation Auto accept\n");
 				break;
 
 			case SM_EVENT_IDENTITY_RESOLVING_STARTED:
-				PRINTF("[SM] Identity resolving\n");
+				LOG("[SM] Identity resolving\n");
 				break;
 			case SM_EVENT_JUST_WORKS_REQUEST:
-				PRINTF("[SM] Just Works requested\n");
+				LOG("[SM] Just Works requested\n");
 				sm_just_works_confirm(sm_event_just_works_request_get_handle(packet));
 				break;
 			case SM_EVENT_NUMERIC_COMPARISON_REQUEST:
-				PRINTF("[SM] Confirming numeric comparison: %"PRIu32"\n", sm_event_numeric_comparison_request_get_passkey(packet));
+				LOG("[SM] Confirming numeric comparison: %"PRIu32"\n", sm_event_numeric_comparison_request_get_passkey(packet));
 				sm_numeric_comparison_confirm(sm_event_passkey_display_number_get_handle(packet));
 				break;
 			case SM_EVENT_PASSKEY_DISPLAY_NUMBER:
-				PRINTF("[SM] Display Passkey: %"PRIu32"\n", sm_event_passkey_display_number_get_passkey(packet));
+				LOG("[SM] Display Passkey: %"PRIu32"\n", sm_event_passkey_display_number_get_passkey(packet));
 				break;
 
 			case RFCOMM_EVENT_INCOMING_CONNECTION:
-				rfcomm_event_incoming_connection_get_bd_addr(packet, event_addr);
 				rfcomm_channel_nr = rfcomm_event_incoming_connection_get_server_channel(packet);
 				rfcomm_channel_id = rfcomm_event_incoming_connection_get_rfcomm_cid(packet);
-				printf("RFCOMM channel %u requested for %s\n", rfcomm_channel_nr, bd_addr_to_str(event_addr));
+				LOG("RFCOMM channel %u requested\n", rfcomm_channel_nr);
 				rfcomm_accept_connection(rfcomm_channel_id);
 				break;
 
 			case RFCOMM_EVENT_CHANNEL_OPENED:
 				if (rfcomm_event_channel_opened_get_status(packet)) {
-				printf("RFCOMM channel open failed, status 0x%02x\n", rfcomm_event_channel_opened_get_status(packet));
+				LOG("RFCOMM channel open failed, status 0x%02x\n", rfcomm_event_channel_opened_get_status(packet));
 				} else {
 				rfcomm_channel_id = rfcomm_event_channel_opened_get_rfcomm_cid(packet);
 				mtu = rfcomm_event_channel_opened_get_max_frame_size(packet);
-				printf("RFCOMM channel open succeeded. New RFCOMM Channel ID %u, max frame size %u\n", rfcomm_channel_id, mtu);
+				rfcomm_mtu = mtu;
+				tx_head = 0;
+				tx_tail = 0;
+				LOG("RFCOMM channel open succeeded. New RFCOMM Channel ID %u, max frame size %u\n", rfcomm_channel_id, mtu);
 				}
 				break;
 			case RFCOMM_EVENT_CAN_SEND_NOW:
-				//rfcomm_send(rfcomm_channel_id, (uint8_t*) lineBuffer, (uint16_t) strlen(lineBuffer));  
+				bluetooth_send();
 				break;
 
 			case RFCOMM_EVENT_CHANNEL_CLOSED:
-				printf("RFCOMM channel closed\n");
+				LOG("RFCOMM channel closed\n");
 				rfcomm_channel_id = 0;
 				break;
 
@@ -271,42 +408,16 @@ static void packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *pack
 		}
 		break;
 
-		case RFCOMM_DATA_PACKET: {
-			int tmp = 0;
-			for (i = 0; i < size; i++) {
-				if (! isdigit(packet[i]))
-					break;
-
-				if (tmp > 10000)
-					break;
-			
-				tmp *= 10;
-				tmp += packet[i] - '0';
-			}
-			printf("%d\n", tmp);
-			bt_data->command1 = tmp;
-			tmp = 0;
-			if (i < size && packet[i] == ' ')
-				i++;
-
-			for (; i < size; i++) {
-				if (! isdigit(packet[i]))
-					break;
-
-				if (tmp > 10000)
-					break;
-			
-				tmp *= 10;
-				tmp += packet[i] - '0';
-			}
-			printf("%d\n", tmp);
-			bt_data->command2 = tmp;
+		case RFCOMM_DATA_PACKET:
+			command_receive(bt_data->commands, packet, size);
+			command_end(bt_data->commands);
 			break;
-		}
 
 		default:
 			break;
 	}
+
+	trace_end(trace_packet, trace_value);
 }
 
 int btstack_main(struct bt_data_t *data)
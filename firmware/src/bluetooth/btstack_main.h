@@ -7,14 +7,36 @@
 #ifndef HAPTIC_BRACELET_BLUETOOTH
 #define HAPTIC_BRACELET_BLUETOOTH
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "command.h"
 
 struct bt_data_t {
-	bool volatile _Atomic connected;
-	int  volatile _Atomic command1;
-	int  volatile _Atomic command2;
+	// Only a gate, relaxed: the command link orders the pulses itself
+	bool _Atomic connected;
+	struct command_link_t *commands;
 };
 
 int btstack_main(struct bt_data_t *data);
 
+/*
+ * bluetooth_reply:
+ *
+ * command_reply_t for the RFCOMM channel. Buffered, sent when the stack
+ * allows it. Dropped if nobody is connected.
+ */
+void bluetooth_reply(const char *data, size_t size);
+
+/*
+ * bluetooth_disconnect:
+ *
+ * Drop the connection, and with forget the link keys of every paired
+ * host too. Safe from any context, done from the BTstack run loop. The
+ * keys are rewritten in BTstack's flash bank, which the event log stays
+ * clear of (eventlog.c asserts it).
+ */
+void bluetooth_disconnect(bool forget);
+
 #endif /* HAPTIC_BRACELET_BLUETOOTH */
\ No newline at end of file
@@ -0,0 +1,584 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/malloc.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "command.h"
+#include "pool.h"
+#include "counter.h"
+#include "detent.h"
+#include "eventlog.h"
+#include "timing.h"
+#include "trace.h"
+
+#define COMMAND_LINE_MAX 64
+
+// Download chunk: "B <length>\n" and the bytes
+#define COMMAND_CHUNK_HEADER_MAX 8
+#define COMMAND_CHUNK_MAX        240
+
+enum schedule_state {schedule_free, schedule_armed};
+enum command_download {download_none, download_eventlog, download_trace, download_counters};
+
+struct command_schedule_t {
+	volatile _Atomic int state;
+	uint32_t id;
+	us_t at;
+	ms_t ms;
+};
+
+// A pulse the timer callback started, for the host
+struct command_ack_t {
+	uint32_t id;
+	us_t at;
+	ms_t ms;
+};
+
+struct command_link_t {
+	// Transport context
+	command_reply_t reply;
+	uint8_t source;
+	char   line[COMMAND_LINE_MAX];
+	size_t line_length;
+	enum command_download download;
+	size_t download_offset;
+	uint8_t counters[2 + 4 * counter_count];	// snapshot being downloaded
+	size_t  counters_size;
+
+	// Shared
+	ms_t queue[COMMAND_QUEUE_SIZE];
+	volatile size_t _Atomic head;	// written by the transport
+	volatile size_t _Atomic tail;	// written by the timer callback
+
+	struct command_schedule_t schedule[COMMAND_SCHEDULE_SIZE];
+	struct detent_t *detent;
+
+	volatile bool _Atomic acks_enabled;
+	struct command_ack_t acks[COMMAND_ACK_SIZE];
+	volatile size_t _Atomic ack_head;	// written by the timer callback
+	volatile size_t _Atomic ack_tail;	// written by the transport
+};
+
+POOL(command_link, struct command_link_t, STATIC_COMMAND_LINKS)
+
+void command_link_new(struct command_link_t **ptr, command_reply_t reply, uint8_t source)
+{
+	struct command_link_t *new = command_link_pool_alloc();
+
+	new->reply = reply;
+	new->source = source;
+	new->line_length = 0;
+	new->download = download_none;
+	new->download_offset = 0;
+	new->counters_size = 0;
+	new->head = 0;
+	new->tail = 0;
+
+	for (size_t i = 0; i < COMMAND_SCHEDULE_SIZE; i++)
+		new->schedule[i].state = schedule_free;
+
+	detent_new(&(new->detent));
+
+	new->acks_enabled = false;
+	new->ack_head = 0;
+	new->ack_tail = 0;
+
+	*ptr = new;
+}
+
+static inline void command_push(struct command_link_t *ptr, ms_t ms)
+{
+	size_t head = ptr->head;
+	size_t head_next = (head + 1) % COMMAND_QUEUE_SIZE;
+
+	// Full, drop the newest
+	if (head_next == ptr->tail) {
+		counter_increment(counter_commands_dropped);
+		return;
+	}
+
+	ptr->queue[head] = ms;
+	ptr->head = head_next;
+	trace_instant(trace_enqueue, ms);
+}
+
+static inline size_t parse_ms(const char *line, size_t size, size_t i, ms_t *ms)
+{
+	ms_t tmp = 0;
+	for (; i < size; i++) {
+		if (!isdigit((unsigned char)line[i]))
+			break;
+
+		if (tmp > 10000)
+			break;
+
+		tmp *= 10;
+		tmp += line[i] - '0';
+	}
+	*ms = tmp;
+	return i;
+}
+
+static inline void command_reply(struct command_link_t *ptr, const char *data, size_t size)
+{
+	if (ptr->reply != NULL)
+		ptr->reply(data, size);
+}
+
+static inline void command_ping(struct command_link_t *ptr, const char *line, size_t size)
+{
+	us_t now = us_now();
+
+	// Echo the token as is, the host matches on it
+	size_t i = 1;
+	while (i < size && line[i] == ' ')
+		i++;
+
+	char buffer[COMMAND_LINE_MAX + 32];
+	int length = snprintf(buffer, sizeof(buffer), "P %.*s %" PRIu64 "\n", (int)(size - i), line + i, now);
+	if (length > 0)
+		command_reply(ptr, buffer, length);
+}
+
+static inline uint64_t parse_u64(const char *line, size_t size, size_t *i)
+{
+	while (*i < size && line[*i] == ' ')
+		(*i)++;
+
+	uint64_t ret = 0;
+	for (; *i < size; (*i)++) {
+		if (!isdigit((unsigned char)line[*i]))
+			break;
+
+		ret *= 10;
+		ret += line[*i] - '0';
+	}
+	return ret;
+}
+
+static inline int32_t parse_i32(const char *line, size_t size, size_t *i)
+{
+	while (*i < size && line[*i] == ' ')
+		(*i)++;
+
+	bool negative = false;
+	if (*i < size && line[*i] == '-') {
+		negative = true;
+		(*i)++;
+	}
+
+	int32_t ret = parse_u64(line, size, i);
+	return negative ? -ret : ret;
+}
+
+static inline void command_schedule(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	uint32_t id = parse_u64(line, size, &i);
+	us_t at     = parse_u64(line, size, &i);
+	ms_t ms     = parse_u64(line, size, &i);
+
+	if (ms == 0 || ms > 10000)
+		return;
+
+	eventlog_add(eventlog_scheduled, ptr->source, ms);
+
+	for (size_t j = 0; j < COMMAND_SCHEDULE_SIZE; j++) {
+		struct command_schedule_t *slot = &(ptr->schedule[j]);
+		if (slot->state != schedule_free)
+			continue;
+
+		slot->id = id;
+		slot->at = at;
+		slot->ms = ms;
+		slot->state = schedule_armed; // publish last
+		return;
+	}
+	// Full, drop
+	counter_increment(counter_commands_dropped);
+}
+
+static inline void command_cancel(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	uint32_t id = parse_u64(line, size, &i);
+
+	for (size_t j = 0; j < COMMAND_SCHEDULE_SIZE; j++) {
+		struct command_schedule_t *slot = &(ptr->schedule[j]);
+		if (slot->state != schedule_armed || slot->id != id)
+			continue;
+
+		// Loses the race if the timer callback is taking it right now
+		int expected = schedule_armed;
+		atomic_compare_exchange_strong(&(slot->state), &expected, schedule_free);
+	}
+}
+
+static inline void command_detent(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	int32_t spacing  = parse_i32(line, size, &i);
+	int32_t position = parse_i32(line, size, &i);
+
+	detent_set(ptr->detent, spacing, position, us_now());
+}
+
+static inline void command_acks(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	ptr->acks_enabled = parse_u64(line, size, &i) != 0;
+}
+
+static inline void command_download(struct command_link_t *ptr, enum command_download download)
+{
+	// The trace records again once nobody is reading it
+	if (ptr->download == download_trace)
+		trace_thaw();
+
+	ptr->download = download;
+	ptr->download_offset = 0;
+}
+
+static inline void command_log(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	while (i < size && line[i] == ' ')
+		i++;
+
+	char op = (i < size) ? line[i] : 's';
+	switch (op) {
+		case 'd':
+			eventlog_flush();
+			command_download(ptr, download_eventlog);
+			return;
+
+		case 'e':
+			if (ptr->download == download_eventlog)
+				command_download(ptr, download_none);
+			eventlog_erase();
+			return;
+
+		case 'f':
+			eventlog_flush();
+			return;
+
+		default:
+			break;
+	}
+
+	char buffer[64];
+	int length = snprintf(buffer, sizeof(buffer), "L %zu %zu %" PRIu32 "\n",
+		eventlog_size(), eventlog_capacity(), eventlog_dropped());
+	if (length > 0)
+		command_reply(ptr, buffer, length);
+}
+
+static inline void command_trace(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	while (i < size && line[i] == ' ')
+		i++;
+
+	char op = (i < size) ? line[i] : 's';
+	switch (op) {
+		case 'd':
+			command_download(ptr, download_none);
+			trace_freeze();
+			command_download(ptr, download_trace);
+			return;
+
+		case 'c':
+			trace_clear();
+			return;
+
+		default:
+			break;
+	}
+
+	char buffer[48];
+	int length = snprintf(buffer, sizeof(buffer), "R %" PRIu32 " %u\n", trace_total(), TRACE_RING_SIZE);
+	if (length > 0)
+		command_reply(ptr, buffer, length);
+}
+
+static inline void command_counters(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	while (i < size && line[i] == ' ')
+		i++;
+
+	// Names, once per host session
+	if (i < size && line[i] == 'n') {
+		for (int id = 0; id < counter_count; id++) {
+			char buffer[48];
+			int length = snprintf(buffer, sizeof(buffer), "K %d %s\n", id, counter_name(id));
+			if (length > 0 && (size_t)length < sizeof(buffer))
+				command_reply(ptr, buffer, length);
+		}
+		command_reply(ptr, "K\n", 2);
+		return;
+	}
+
+	// Taken now, sent through command_read() like the other downloads
+	ptr->counters_size = counter_snapshot(ptr->counters, sizeof(ptr->counters));
+	command_download(ptr, download_counters);
+}
+
+static inline size_t command_counters_read(struct command_link_t *ptr, size_t offset, uint8_t *buffer, size_t size)
+{
+	if (offset >= ptr->counters_size)
+		return 0;
+
+	if (size > ptr->counters_size - offset)
+		size = ptr->counters_size - offset;
+	memcpy(buffer, ptr->counters + offset, size);
+	return size;
+}
+
+static inline void command_timing(struct command_link_t *ptr, const char *line, size_t size)
+{
+	size_t i = 1;
+	while (i < size && line[i] == ' ')
+		i++;
+
+	if (i < size && line[i] == 'r') {
+		timing_reset();
+		return;
+	}
+
+	struct timing_stats_t stats[timing_sections];
+	if (!timing_read(stats))
+		return;
+
+	for (int section = 0; section < timing_sections; section++) {
+		struct timing_stats_t *s = &stats[section];
+
+		char buffer[32 + 11 * (5 + TIMING_BUCKETS)];
+		int length = snprintf(buffer, sizeof(buffer), "T %s %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32,
+			timing_name(section), s->count, s->min, s->max, s->overruns, s->shed);
+
+		// Up to the last bucket in use, keeps it short
+		int last = TIMING_BUCKETS - 1;
+		while (last > 0 && s->buckets[last] == 0)
+			last--;
+		for (int bucket = 0; bucket <= last && length > 0 && (size_t)length < sizeof(buffer); bucket++)
+			length += snprintf(buffer + length, sizeof(buffer) - length, " %" PRIu32, s->buckets[bucket]);
+
+		if (length <= 0 || (size_t)length >= sizeof(buffer) - 1)
+			continue;
+		buffer[length++] = '\n';
+		command_reply(ptr, buffer, length);
+	}
+	command_reply(ptr, "T\n", 2);
+}
+
+static inline void command_parse(struct command_link_t *ptr, const char *line, size_t size)
+{
+	counter_increment(counter_commands_parsed);
+
+	switch (line[0]) {
+		case 'p':
+			command_ping(ptr, line, size);
+			return;
+
+		case 's':
+			command_schedule(ptr, line, size);
+			return;
+
+		case 'c':
+			command_cancel(ptr, line, size);
+			return;
+
+		case 'd':
+			command_detent(ptr, line, size);
+			return;
+
+		case 'a':
+			command_acks(ptr, line, size);
+			return;
+
+		case 'l':
+			command_log(ptr, line, size);
+			return;
+
+		case 't':
+			command_timing(ptr, line, size);
+			return;
+
+		case 'r':
+			command_trace(ptr, line, size);
+			return;
+
+		case 'k':
+			command_counters(ptr, line, size);
+			return;
+
+		default:
+			break;
+	}
+
+	ms_t ms = 0;
+	size_t i = parse_ms(line, size, 0, &ms);
+	if (ms != 0) {
+		eventlog_add(eventlog_command, ptr->source, ms);
+		command_push(ptr, ms);
+	}
+
+	if (i < size && line[i] == ' ')
+		i++;
+
+	parse_ms(line, size, i, &ms);
+	if (ms != 0) {
+		eventlog_add(eventlog_command, ptr->source, ms);
+		command_push(ptr, ms);
+	}
+}
+
+void command_end(struct command_link_t *ptr)
+{
+	if (ptr->line_length == 0)
+		return;
+
+	command_parse(ptr, ptr->line, ptr->line_length);
+	ptr->line_length = 0;
+}
+
+void command_receive(struct command_link_t *ptr, const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		char c = data[i];
+		if (c == '\n' || c == '\r') {
+			command_end(ptr);
+			continue;
+		}
+
+		// Overlong lines are truncated, not split
+		if (ptr->line_length < COMMAND_LINE_MAX)
+			ptr->line[ptr->line_length++] = c;
+	}
+}
+
+void command_service(struct command_link_t *ptr)
+{
+	size_t tail = ptr->ack_tail;
+	while (tail != ptr->ack_head) {
+		struct command_ack_t *ack = &(ptr->acks[tail]);
+
+		char buffer[64];
+		int length = snprintf(buffer, sizeof(buffer), "A %" PRIu32 " %" PRIu64 " %" PRIu32 "\n", ack->id, ack->at, ack->ms);
+		if (length > 0)
+			command_reply(ptr, buffer, length);
+
+		tail = (tail + 1) % COMMAND_ACK_SIZE;
+		ptr->ack_tail = tail;
+	}
+}
+
+size_t command_read(struct command_link_t *ptr, uint8_t *buffer, size_t size)
+{
+	if (ptr->download == download_none || size <= COMMAND_CHUNK_HEADER_MAX)
+		return 0;
+
+	// Until the page being filled is in flash too
+	if (ptr->download == download_eventlog && eventlog_busy())
+		return 0;
+
+	size_t length = size - COMMAND_CHUNK_HEADER_MAX;
+	if (length > COMMAND_CHUNK_MAX)
+		length = COMMAND_CHUNK_MAX;
+
+	uint8_t data[COMMAND_CHUNK_MAX];
+	if (ptr->download == download_eventlog)
+		length = eventlog_read(ptr->download_offset, data, length);
+	else if (ptr->download == download_counters)
+		length = command_counters_read(ptr, ptr->download_offset, data, length);
+	else
+		length = trace_read(ptr->download_offset, data, length);
+	ptr->download_offset += length;
+
+	// "B 0" ends the download
+	if (length == 0)
+		command_download(ptr, download_none);
+
+	int header = snprintf((char *)buffer, COMMAND_CHUNK_HEADER_MAX, "B %zu\n", length);
+	if (header <= 0)
+		return 0;
+
+	memcpy(buffer + header, data, length);
+	return header + length;
+}
+
+static inline void command_ack(struct command_link_t *ptr, uint32_t id, us_t at, ms_t ms)
+{
+	if (!ptr->acks_enabled)
+		return;
+
+	size_t head = ptr->ack_head;
+	size_t head_next = (head + 1) % COMMAND_ACK_SIZE;
+
+	// Full, the host isn't reading
+	if (head_next == ptr->ack_tail)
+		return;
+
+	ptr->acks[head].id = id;
+	ptr->acks[head].at = at;
+	ptr->acks[head].ms = ms;
+	ptr->ack_head = head_next;
+}
+
+static inline bool command_next(struct command_link_t *ptr, us_t now, ms_t *ms, uint32_t *id)
+{
+	// Scheduled pulses first, they are the ones with a deadline
+	for (size_t i = 0; i < COMMAND_SCHEDULE_SIZE; i++) {
+		struct command_schedule_t *slot = &(ptr->schedule[i]);
+		if (slot->state != schedule_armed || slot->at > now)
+			continue;
+
+		ms_t tmp = slot->ms;
+		uint32_t tmp_id = slot->id;
+		int expected = schedule_armed;
+		if (!atomic_compare_exchange_strong(&(slot->state), &expected, schedule_free))
+			continue; // cancelled meanwhile
+
+		*ms = tmp;
+		*id = tmp_id;
+		return true;
+	}
+
+	if (detent_click(ptr->detent, now)) {
+		*ms = DETENT_PULSE_MS;
+		return true;
+	}
+
+	size_t tail = ptr->tail;
+	if (tail == ptr->head)
+		return false;
+
+	*ms = ptr->queue[tail];
+	ptr->tail = (tail + 1) % COMMAND_QUEUE_SIZE;
+	return true;
+}
+
+bool command_pop(struct command_link_t *ptr, ms_t *ms)
+{
+	us_t now = us_now();
+	uint32_t id = 0;
+	if (!command_next(ptr, now, ms, &id))
+		return false;
+
+	command_ack(ptr, id, now, *ms);
+	trace_instant(trace_dequeue, *ms);
+	return true;
+}
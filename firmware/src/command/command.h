@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_COMMAND_H
+#define HAPTIC_BRACELET_FIRMWARE_COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * struct command_link_t:
+ *
+ * One per transport (RFCOMM, USB). The transport pushes the bytes it
+ * receives, the timer callback pops the pulses. Single producer, single
+ * consumer, so the two sides never wait on each other.
+ */
+struct command_link_t;
+
+/*
+ * command_reply_t:
+ *
+ * Send bytes back to the host. Only called from the transport context,
+ * from within command_receive()/command_end().
+ */
+typedef void (*command_reply_t)(const char *data, size_t size);
+
+/*
+ * command_link_new:
+ *
+ * source is the enum eventlog_source the link's events are logged with.
+ */
+void command_link_new(struct command_link_t **ptr, command_reply_t reply, uint8_t source);
+
+/*
+ * command_receive:
+ *
+ * Feed received bytes. A line ends at '\n' or '\r'.
+ *
+ * Lines:
+ *   "<ms> <ms>"  Queue one or two pulses (what rfcomm.cs sends)
+ *   "p <token>"  Ping, replies "P <token> <device us>"
+ *   "s <id> <device us> <ms>"
+ *                Pulse at a point in device time (us_now()). Late ones run
+ *                right away. Lets the host line up several bracelets.
+ *   "c <id>"     Cancel scheduled pulses with this id, if not started yet.
+ *   "d <spacing> <position>"
+ *                Click on every multiple of spacing the position crosses,
+ *                timed on the device between updates. Integers, any unit
+ *                (rfcomm.cs uses thousandths). Spacing 0 stops.
+ *   "a <0|1>"    Acknowledge every pulse started from this link with
+ *                "A <id> <device us> <ms>" (id 0 unless scheduled).
+ *   "l [s|d|f|e]"
+ *                Event log: status, replies "L <bytes> <capacity> <dropped>";
+ *                download, see command_read(); flush; erase.
+ *   "r [s|d|c]"  Trace (trace.h): status, replies "R <records> <capacity>";
+ *                download, like the event log's; clear.
+ *   "k [n]"      Counters (counter.h): a snapshot, downloaded like the
+ *                event log's (see command_read()). "k n" replies
+ *                "K <index> <name>" for each, then "K".
+ *   "t [r]"      Timer callback timing, one line per section (see timing.h):
+ *                "T <name> <count> <min us> <max us> <overruns> <shed> <buckets...>",
+ *                buckets up to the last non empty one, then "T". "t r" resets.
+ */
+void command_receive(struct command_link_t *ptr, const uint8_t *data, size_t size);
+
+/*
+ * command_end:
+ *
+ * Terminate a partial line. RFCOMM delivers one line per packet, with or
+ * without the newline.
+ */
+void command_end(struct command_link_t *ptr);
+
+/*
+ * command_service:
+ *
+ * Send what the timer callback left for the host (pulse acks). Called
+ * periodically from the transport context.
+ */
+void command_service(struct command_link_t *ptr);
+
+/*
+ * command_read:
+ *
+ * Bulk data for the host, pulled by the transport whenever it has room
+ * for it. Up to size bytes: an event log or trace download chunk, "B <length>\n"
+ * followed by that many raw bytes. Chunks are whole, so replies can go
+ * in between them. "B 0\n" ends the download. 0 if there is nothing to
+ * send now.
+ */
+size_t command_read(struct command_link_t *ptr, uint8_t *buffer, size_t size);
+
+/*
+ * command_pop:
+ *
+ * Due scheduled pulse, else a detent click, else the oldest queued one.
+ * False if there is nothing to run. The pulse is taken as started now.
+ */
+bool command_pop(struct command_link_t *ptr, ms_t *ms);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_COMMAND_H */
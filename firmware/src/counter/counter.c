@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "counter.h"
+
+#define COUNTER_NAME(name) #name,
+
+volatile uint32_t _Atomic counters[counter_count];
+
+static const char *const counter_names[counter_count] = {
+	COUNTERS(COUNTER_NAME)
+};
+
+const char *counter_name(enum counter_id id)
+{
+	if (id >= counter_count)
+		return "?";
+	return counter_names[id];
+}
+
+size_t counter_snapshot(uint8_t *buffer, size_t size)
+{
+	size_t length = 2 + 4 * counter_count;
+	if (size < length)
+		return 0;
+
+	buffer[0] = counter_count;
+	buffer[1] = counter_count >> 8;
+	for (size_t i = 0; i < counter_count; i++) {
+		uint32_t value = atomic_load_explicit(&counters[i], memory_order_relaxed);
+		uint8_t *p = &buffer[2 + 4 * i];
+		p[0] = value;
+		p[1] = value >> 8;
+		p[2] = value >> 16;
+		p[3] = value >> 24;
+	}
+	return length;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_COUNTER_H
+#define HAPTIC_BRACELET_FIRMWARE_COUNTER_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Counters:
+ *
+ * Named 32 bit counters and gauges, for seeing how a device behaves
+ * between debug sessions. Bumped from any context with one relaxed
+ * atomic add, read with the "k" command. They wrap, and start over at
+ * boot.
+ *
+ * New ones go at the end of the list, the snapshot is in this order.
+ */
+#define COUNTERS(X) \
+	X(commands_parsed)	/* lines from any link */ \
+	X(commands_dropped)	/* queue or schedule full */ \
+	X(pulses_device)	/* pulses started, by enum eventlog_source */ \
+	X(pulses_bluetooth) \
+	X(pulses_usb) \
+	X(motor_faults) \
+	X(bt_connects) \
+	X(bt_disconnects) \
+	X(bt_disconnect_timeout)	/* reason 0x08 */ \
+	X(bt_disconnect_remote)	/* reason 0x13 */ \
+	X(bt_disconnect_local)	/* reason 0x16 */ \
+	X(bt_disconnect_reason)	/* gauge, the last one */ \
+	X(tick_overruns) \
+	X(tick_shed) \
+	X(adc_samples)	/* converted, overwritten or not */ \
+	X(log_dropped) \
+	X(eventlog_dropped) \
+	X(digital_edges_dropped)	/* edge ring full */ \
+	X(reply_bytes_dropped)	/* host not reading replies */
+
+#define COUNTER_ENUM(name) counter_##name,
+
+enum counter_id {
+	COUNTERS(COUNTER_ENUM)
+	counter_count
+};
+
+extern volatile uint32_t _Atomic counters[counter_count];
+
+static inline void counter_add(enum counter_id id, uint32_t value)
+{
+	atomic_fetch_add_explicit(&counters[id], value, memory_order_relaxed);
+}
+
+static inline void counter_increment(enum counter_id id)
+{
+	counter_add(id, 1);
+}
+
+// Gauges
+static inline void counter_set(enum counter_id id, uint32_t value)
+{
+	atomic_store_explicit(&counters[id], value, memory_order_relaxed);
+}
+
+const char *counter_name(enum counter_id id);
+
+/*
+ * counter_snapshot:
+ *
+ * Little endian: uint16_t count, then count uint32_t values in enum
+ * order. Returns the size, 0 if buffer is too small.
+ */
+size_t counter_snapshot(uint8_t *buffer, size_t size);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_COUNTER_H */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/malloc.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "detent.h"
+#include "pool.h"
+
+// Slower updates than this are treated as a jump, not a drag
+#define DETENT_SPAN_MAX_US 200000
+
+struct detent_input_t {
+	int32_t spacing;
+	int32_t position;
+	us_t at;
+};
+
+struct detent_t {
+	// Written by detent_set(), odd sequence while writing
+	volatile uint32_t _Atomic sequence;
+	struct detent_input_t input;
+
+	// Timer callback
+	uint32_t seen;
+	struct detent_input_t last;
+	int32_t from;
+	int32_t to;
+	us_t    start;
+	us_t    span;
+	int32_t index;
+	uint32_t pending;
+};
+
+POOL(detent, struct detent_t, STATIC_DETENTS)
+
+void detent_new(struct detent_t **ptr)
+{
+	struct detent_t *new = detent_pool_alloc();
+
+	new->sequence = 0;
+	new->input.spacing = 0;
+	new->input.position = 0;
+	new->input.at = 0;
+
+	new->seen = 0;
+	new->last = new->input;
+	new->from = 0;
+	new->to = 0;
+	new->start = 0;
+	new->span = 1;
+	new->index = 0;
+	new->pending = 0;
+
+	*ptr = new;
+}
+
+void detent_set(struct detent_t *ptr, int32_t spacing, int32_t position, us_t at)
+{
+	uint32_t sequence = atomic_load_explicit(&(ptr->sequence), memory_order_relaxed);
+	atomic_store_explicit(&(ptr->sequence), sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	ptr->input.spacing  = spacing;
+	ptr->input.position = position;
+	ptr->input.at       = at;
+
+	atomic_store_explicit(&(ptr->sequence), sequence + 2, memory_order_release);
+}
+
+// Rounds towards -inf, so 0 isn't twice as wide as the other detents
+static inline int32_t detent_index(int32_t position, int32_t spacing)
+{
+	int32_t index = position / spacing;
+	if (position % spacing != 0 && position < 0)
+		index--;
+	return index;
+}
+
+static inline int32_t detent_position(struct detent_t *ptr, us_t now)
+{
+	us_t elapsed = now - ptr->start;
+	if (elapsed >= ptr->span)
+		return ptr->to;
+
+	int64_t delta = (int64_t)ptr->to - ptr->from;
+	return ptr->from + (int32_t)(delta * (int64_t)elapsed / (int64_t)ptr->span);
+}
+
+// Take the latest input, unless it is being written right now
+static inline void detent_read(struct detent_t *ptr, us_t now)
+{
+	uint32_t sequence = atomic_load_explicit(&(ptr->sequence), memory_order_acquire);
+	if (sequence == ptr->seen || (sequence & 1))
+		return;
+
+	struct detent_input_t input = ptr->input;
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&(ptr->sequence), memory_order_relaxed) != sequence)
+		return;
+
+	ptr->seen = sequence;
+
+	if (input.spacing <= 0) {
+		ptr->last = input;
+		return;
+	}
+
+	// (Re)start without clicking
+	if (input.spacing != ptr->last.spacing) {
+		ptr->from  = input.position;
+		ptr->to    = input.position;
+		ptr->span  = 1;
+		ptr->index = detent_index(input.position, input.spacing);
+		ptr->pending = 0;
+		ptr->last  = input;
+		return;
+	}
+
+	// Move from where we are now to the update, over one update interval
+	us_t span = input.at - ptr->last.at;
+	if (span == 0 || span > DETENT_SPAN_MAX_US)
+		span = 1;
+
+	ptr->from  = detent_position(ptr, now);
+	ptr->to    = input.position;
+	ptr->start = now;
+	ptr->span  = span;
+	ptr->last  = input;
+}
+
+bool detent_click(struct detent_t *ptr, us_t now)
+{
+	detent_read(ptr, now);
+
+	int32_t spacing = ptr->last.spacing;
+	if (spacing <= 0)
+		return false;
+
+	int32_t index = detent_index(detent_position(ptr, now), spacing);
+	if (index != ptr->index) {
+		uint32_t crossed = abs(index - ptr->index);
+		ptr->pending += crossed;
+		if (ptr->pending > DETENT_PENDING_MAX)
+			ptr->pending = DETENT_PENDING_MAX;
+		ptr->index = index;
+	}
+
+	if (ptr->pending == 0)
+		return false;
+
+	ptr->pending--;
+	return true;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_DETENT_H
+#define HAPTIC_BRACELET_FIRMWARE_DETENT_H
+
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * struct detent_t:
+ *
+ * Clicks when a position crosses a multiple of the spacing. The position
+ * is streamed by the host at a modest rate, the clicks are timed here: the
+ * rendered position moves towards each update over one update interval, so
+ * fast drags still click once per notch, evenly spaced.
+ *
+ * detent_set() is called by one context (a transport), detent_click() by
+ * another (the timer callback).
+ */
+struct detent_t;
+
+void detent_new(struct detent_t **ptr);
+
+/*
+ * detent_set:
+ *
+ * New position, in the same units as the spacing. Spacing 0 turns clicks
+ * off. A new spacing restarts from the given position without clicking.
+ */
+void detent_set(struct detent_t *ptr, int32_t spacing, int32_t position, us_t at);
+
+/*
+ * detent_click:
+ *
+ * Is there a detent crossing up to now that I haven't consumed?
+ */
+bool detent_click(struct detent_t *ptr, us_t now);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_DETENT_H */
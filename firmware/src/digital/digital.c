@@ -4,117 +4,376 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include "hardware/gpio.h"
 #include "pico/stdlib.h"
-#include "pico/malloc.h"
 
+#include "config.h"
 #include "config_adv.h"
+#include "counter.h"
 #include "digital.h"
 
-struct digital_t {
-	uint pin;
-	bool invert;
-	volatile bool _Atomic prev;
-	volatile ms_t _Atomic held_since;
+#define DIGITAL_EDGE_MASK (DIGITAL_EDGE_RING_SIZE - 1)
 
-	// External
-	volatile bool _Atomic trap;
-	volatile bool _Atomic went_true;
-	volatile bool _Atomic went_false;
-	volatile ms_t _Atomic held_for;
-};
+// The bank, every input by pin
+static struct digital_t *digital_pins[NUM_BANK0_GPIOS];
+static uint64_t digital_mask;		// pins with an input
+static uint64_t digital_inverted;	// low_is_true ones
+static uint64_t digital_snapshot;	// last gpio_get_all64(), polling
 
-void digital_new(struct digital_t **ptr, uint pin, int type)
+// Debounced every tick, by strategy
+static uint64_t digital_ticked;		// integrator and lockout
+static uint64_t digital_vertical;
+
+/*
+ * Vertical counter (DIGITAL_DEBOUNCE_VERTICAL): a 2 bit counter per pin,
+ * bit 0 of every pin in ct0, bit 1 in ct1. It counts the ticks a pin's
+ * raw level has been off its debounced one, and toggles it at 4. Every
+ * pin at once, in a few instructions.
+ */
+static uint64_t digital_levels;		// raw, true is 1
+static uint64_t digital_state;		// debounced
+static uint64_t digital_ct0 = ~0ull;
+static uint64_t digital_ct1 = ~0ull;
+
+static inline bool digital_read(struct digital_t *ptr)
+{
+	bool now = gpio_get(ptr->pin);
+	if (ptr->invert)
+		now = !now;
+	return now;
+}
+
+#if DIGITAL_EDGE_IRQ
+// Called with every edge, once set
+static void (*_Atomic digital_edge_handler)(void);
+
+static inline void digital_push(struct digital_t *ptr, bool level, us_t at)
 {
-	// TODO error check ptr
+	uint32_t head = atomic_load_explicit(&(ptr->head), memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&(ptr->tail), memory_order_acquire);
+	if (head - tail >= DIGITAL_EDGE_RING_SIZE) {
+		counter_increment(counter_digital_edges_dropped);
+		return;
+	}
+
+	ptr->edges[head & DIGITAL_EDGE_MASK].at    = at;
+	ptr->edges[head & DIGITAL_EDGE_MASK].level = level;
+	atomic_store_explicit(&(ptr->head), head + 1, memory_order_release);
+}
+
+static void digital_irq(uint gpio, uint32_t events)
+{
+	us_t at = time_us_64();
+
+	struct digital_t *ptr = digital_pins[gpio];
+	if (ptr == NULL)
+		return;
 
-	struct digital_t *new = malloc(sizeof(struct digital_t));
-	if (new == NULL) {
-		// error
+	bool rise = events & GPIO_IRQ_EDGE_RISE;
+	bool fall = events & GPIO_IRQ_EDGE_FALL;
+
+	// Both latched: a glitch shorter than the interrupt latency, the pin is at the last one
+	bool high = rise;
+	if (rise && fall) {
+		high = gpio_get(gpio);
+		digital_push(ptr, high == ptr->invert, at);
 	}
+	digital_push(ptr, high != ptr->invert, at);
+
+	void (*handler)(void) = atomic_load_explicit(&digital_edge_handler, memory_order_acquire);
+	if (handler != NULL)
+		handler();
+}
 
-	new->pin = pin;
-	gpio_init(new->pin);
-	gpio_set_dir(new->pin, GPIO_IN);
+void digital_on_edge(void (*handler)(void))
+{
+	atomic_store_explicit(&digital_edge_handler, handler, memory_order_release);
+}
+#endif
 
-	new->invert = false;
+void digital_init(struct digital_t *ptr, uint pin, int type, int debounce)
+{
+	ptr->pin = pin;
+	gpio_init(ptr->pin);
+	gpio_set_dir(ptr->pin, GPIO_IN);
+
+	ptr->invert = false;
 	if (type == low_is_true) {
-		new->invert = true;
+		ptr->invert = true;
 		gpio_pull_up(pin);
 	}
 
-	new->prev = false;
-	new->trap = false;
-	new->went_true = false;
-	new->went_false = false;
-	new->held_for = 0;
+	ptr->debounce = debounce;
+	ptr->prev = false;
+	atomic_init(&(ptr->stamps), 0);
+	atomic_init(&(ptr->held_since.low), 0);
+	atomic_init(&(ptr->held_since.high), 0);
+	atomic_init(&(ptr->released_at.low), 0);
+	atomic_init(&(ptr->released_at.high), 0);
+	atomic_init(&(ptr->trap), false);
+	atomic_init(&(ptr->went_true), false);
+	atomic_init(&(ptr->went_false), false);
+	atomic_init(&(ptr->held_for), 0);
+
+	ptr->raw = false;
+	ptr->raw_at = 0;
+	ptr->locked_until = 0;
+	ptr->count = 0;
+
+	uint64_t bit = 1ull << pin;
+	if (ptr->invert)
+		digital_inverted |= bit;
+	else
+		digital_inverted &= ~bit;
+
+	// Starts false, an input already true goes true on the first update
+	digital_snapshot = (digital_snapshot & ~bit) | (digital_inverted & bit);
+	digital_levels &= ~bit;
+	digital_state  &= ~bit;
+	digital_ct0    |= bit;
+	digital_ct1    |= bit;
+
+	if (debounce == DIGITAL_DEBOUNCE_INTEGRATOR || debounce == DIGITAL_DEBOUNCE_LOCKOUT)
+		digital_ticked |= bit;
+	if (debounce == DIGITAL_DEBOUNCE_VERTICAL)
+		digital_vertical |= bit;
 
-	*ptr = new;
+	digital_pins[pin] = ptr;
+	digital_mask |= bit;
+
+#if DIGITAL_EDGE_IRQ
+	atomic_init(&(ptr->head), 0);
+	atomic_init(&(ptr->tail), 0);
+
+	// Same with edges
+	digital_push(ptr, digital_read(ptr), time_us_64());
+
+	gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, digital_irq);
+#endif
 }
 
-void digital_free(struct digital_t *ptr)
+// Only the tick writes (the timer callback, or the edge handler at its
+// priority), nothing reading preempts it
+static inline void digital_stamp(struct digital_t *ptr, struct digital_stamp_t *stamp, us_t at)
 {
-	free(ptr);
+	uint32_t sequence = atomic_load_explicit(&(ptr->stamps), memory_order_relaxed);
+	atomic_store_explicit(&(ptr->stamps), sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	atomic_store_explicit(&(stamp->low),  (uint32_t)at,         memory_order_relaxed);
+	atomic_store_explicit(&(stamp->high), (uint32_t)(at >> 32), memory_order_relaxed);
+
+	atomic_store_explicit(&(ptr->stamps), sequence + 2, memory_order_release);
 }
 
-bool digital_now(struct digital_t *ptr)
+// Halves of the same write, else try again
+static inline us_t digital_stamp_read(struct digital_t *ptr, struct digital_stamp_t *stamp)
 {
-	bool now = gpio_get(ptr->pin);
-	if (ptr->invert)
-		now = !now;
-	return now;
+	for (;;) {
+		uint32_t before = atomic_load_explicit(&(ptr->stamps), memory_order_acquire);
+		uint32_t low  = atomic_load_explicit(&(stamp->low),  memory_order_relaxed);
+		uint32_t high = atomic_load_explicit(&(stamp->high), memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+		uint32_t after = atomic_load_explicit(&(ptr->stamps), memory_order_relaxed);
+
+		if (before == after && (before & 1) == 0)
+			return ((us_t)high << 32) | low;
+	}
 }
 
-void digital_update(struct digital_t *ptr)
+// Debounced transition
+static inline void digital_edge(struct digital_t *ptr, bool now, us_t at)
 {
-	bool now = digital_now(ptr);
-
 	// Update trap
 	if (now == true)
-		ptr->trap = now;
+		atomic_store_explicit(&(ptr->trap), true, memory_order_relaxed);
 
 	// If we transition {false -> true}
 	if (ptr->prev == false && now == true) {
-		ptr->went_true = true;
-		ptr->held_since = ms_now();
+		atomic_store_explicit(&(ptr->went_true), true, memory_order_relaxed);
+		digital_stamp(ptr, &(ptr->held_since), at);
 	}
 
 	// If we transition {true -> false}
 	if (ptr->prev == true && now == false) {
-		ptr->went_false = true;
-		ms_t tmp = ms_now() - ptr->held_since;
+		atomic_store_explicit(&(ptr->went_false), true, memory_order_relaxed);
+		digital_stamp(ptr, &(ptr->released_at), at);
+		ms_t tmp = (at - digital_stamp_read(ptr, &(ptr->held_since))) / 1000;
 		if (tmp >= 1000)
-			ptr->held_for = tmp;
+			atomic_store_explicit(&(ptr->held_for), tmp, memory_order_relaxed);
 	}
 
 	ptr->prev = now;
 }
 
+// Raw transition, from the snapshot or the edge ring
+static inline void digital_raw_edge(struct digital_t *ptr, bool level, us_t at)
+{
+	uint64_t bit = 1ull << ptr->pin;
+
+	ptr->raw    = level;
+	ptr->raw_at = at;
+	digital_levels = level ? (digital_levels | bit) : (digital_levels & ~bit);
+
+	switch (ptr->debounce) {
+		case DIGITAL_DEBOUNCE_NONE:
+			digital_edge(ptr, level, at);
+			break;
+
+		// Take the first edge right away, then nothing for a while
+		case DIGITAL_DEBOUNCE_LOCKOUT:
+			if (at >= ptr->locked_until && level != ptr->prev) {
+				digital_edge(ptr, level, at);
+				ptr->locked_until = at + DIGITAL_LOCKOUT_US;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+// Once per tick, after the raw transitions
+static inline void digital_tick(struct digital_t *ptr, us_t now)
+{
+	switch (ptr->debounce) {
+		// Where the pin settled while locked out
+		case DIGITAL_DEBOUNCE_LOCKOUT:
+			if (ptr->raw != ptr->prev && now >= ptr->locked_until) {
+				us_t at = (ptr->raw_at > ptr->locked_until) ? ptr->raw_at : ptr->locked_until;
+				digital_edge(ptr, ptr->raw, at);
+				ptr->locked_until = at + DIGITAL_LOCKOUT_US;
+			}
+			break;
+
+		// Count up while true, down while false, switch at the ends
+		case DIGITAL_DEBOUNCE_INTEGRATOR:
+			if (ptr->raw && ptr->count < DIGITAL_INTEGRATOR_TICKS) {
+				if (++ptr->count == DIGITAL_INTEGRATOR_TICKS)
+					digital_edge(ptr, true, now);
+			} else if (!ptr->raw && ptr->count > 0) {
+				if (--ptr->count == 0)
+					digital_edge(ptr, false, now);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+static inline void digital_vertical_tick(us_t now)
+{
+	uint64_t changed = (digital_levels ^ digital_state) & digital_vertical;
+
+	// Counters of unchanged pins reset to 3, the others count down
+	digital_ct0 = ~(digital_ct0 & changed);
+	digital_ct1 = digital_ct0 ^ (digital_ct1 & changed);
+
+	// Rolled over
+	changed &= digital_ct0 & digital_ct1;
+	digital_state ^= changed;
+
+	for (; changed != 0; changed &= changed - 1) {
+		uint pin = __builtin_ctzll(changed);
+		digital_edge(digital_pins[pin], (digital_state >> pin) & 1, now);
+	}
+}
+
+#if DIGITAL_EDGE_IRQ
+void digital_bank_edges(void)
+{
+	// Only what the interrupt saw, at the time it saw it
+	for (uint64_t pins = digital_mask; pins != 0; pins &= pins - 1) {
+		struct digital_t *ptr = digital_pins[__builtin_ctzll(pins)];
+
+		uint32_t tail = atomic_load_explicit(&(ptr->tail), memory_order_relaxed);
+		uint32_t head = atomic_load_explicit(&(ptr->head), memory_order_acquire);
+
+		for (; tail != head; tail++) {
+			struct digital_edge_t *edge = &(ptr->edges[tail & DIGITAL_EDGE_MASK]);
+			digital_raw_edge(ptr, edge->level, edge->at);
+		}
+		atomic_store_explicit(&(ptr->tail), tail, memory_order_release);
+	}
+}
+#endif
+
+void digital_bank_update(void)
+{
+	us_t now = us_now();
+
+#if DIGITAL_EDGE_IRQ
+	digital_bank_edges();
+#else
+	// One read for every input
+	uint64_t snapshot = gpio_get_all64();
+
+	uint64_t changed = (snapshot ^ digital_snapshot) & digital_mask;
+	digital_snapshot = snapshot;
+
+	uint64_t level = snapshot ^ digital_inverted;
+	for (; changed != 0; changed &= changed - 1) {
+		uint pin = __builtin_ctzll(changed);
+		digital_raw_edge(digital_pins[pin], (level >> pin) & 1, now);
+	}
+#endif
+
+	for (uint64_t pins = digital_ticked; pins != 0; pins &= pins - 1)
+		digital_tick(digital_pins[__builtin_ctzll(pins)], now);
+
+	if (digital_vertical != 0)
+		digital_vertical_tick(now);
+}
+
+bool digital_now(struct digital_t *ptr)
+{
+	return ptr->prev;
+}
+
+void digital_discard(struct digital_t *ptr)
+{
+	atomic_store_explicit(&(ptr->went_true),  false, memory_order_relaxed);
+	atomic_store_explicit(&(ptr->went_false), false, memory_order_relaxed);
+	atomic_store_explicit(&(ptr->held_for),   0,     memory_order_relaxed);
+}
+
+us_t digital_pressed_at(struct digital_t *ptr)
+{
+	return digital_stamp_read(ptr, &(ptr->held_since));
+}
+
+us_t digital_released_at(struct digital_t *ptr)
+{
+	return digital_stamp_read(ptr, &(ptr->released_at));
+}
+
 bool digital_trap(struct digital_t *ptr)
 {
-	return ptr->trap;
+	return atomic_load_explicit(&(ptr->trap), memory_order_relaxed);
 }
 
+// Read and clear in one, an edge in between isn't lost
 bool digital_went_true(struct digital_t *ptr)
 {
-	bool ret = ptr->went_true;
-	ptr->went_true = false;
-	return ret;
+	return atomic_exchange_explicit(&(ptr->went_true), false, memory_order_relaxed);
 }
 
 bool digital_went_false(struct digital_t *ptr)
 {
-	bool ret = ptr->went_false;
-	ptr->went_false = false;
-	return ret;
+	return atomic_exchange_explicit(&(ptr->went_false), false, memory_order_relaxed);
 }
 
 bool digital_held_true(struct digital_t *ptr, ms_t at_least)
 {
-	if (at_least > ptr->held_for)
+	ms_t held_for = atomic_load_explicit(&(ptr->held_for), memory_order_relaxed);
+	if (at_least > held_for)
 		return false;
-	
-	ptr->held_for = 0;
+
+	// Unless a newer hold replaced it
+	atomic_compare_exchange_strong_explicit(&(ptr->held_for), &held_for, 0,
+		memory_order_relaxed, memory_order_relaxed);
 	return true;
 }
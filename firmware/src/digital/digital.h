@@ -7,19 +7,110 @@
 #ifndef HAPTIC_BRACELET_FIRMWARE_DIGITAL_H
 #define HAPTIC_BRACELET_FIRMWARE_DIGITAL_H
 
+#include <stdatomic.h>
 #include "pico/stdlib.h"
 
 #include "config_adv.h"
 
 enum digital_io_types {low_is_false, low_is_true};
 
-struct digital_t;
+/*
+ * struct digital_t:
+ *
+ * A GPIO input, true or false after the io type. Transitions are found by
+ * digital_bank_update(), once per tick for every input: one snapshot of
+ * all the pins, compared with the last one, or with DIGITAL_EDGE_IRQ the
+ * edges the GPIO interrupt queued, at the us they happened. Those can also
+ * be taken right away, see digital_on_edge().
+ *
+ * Switches bounce, each input has its debounce (DIGITAL_DEBOUNCE_*):
+ *   NONE        every transition, for the motor fault
+ *   LOCKOUT     the first edge right away, then the level it settles at
+ *               once DIGITAL_LOCKOUT_US have passed
+ *   INTEGRATOR  a count up while true and down while false, once per
+ *               tick, switches at DIGITAL_INTEGRATOR_TICKS and 0
+ *   VERTICAL    4 ticks in a row off the current level, counted for every
+ *               such pin at once, bitwise
+ *
+ * Embedded in the owner. The debounce state is plain, only the tick
+ * touches it; the fields other contexts see are atomic, used through the
+ * accessors below.
+ */
+struct digital_edge_t {
+	us_t at;
+	bool level;
+};
+
+// A us_t in 32 bit halves, the M33 can't load or store 64 bits at once
+struct digital_stamp_t {
+	uint32_t _Atomic low;
+	uint32_t _Atomic high;
+};
+
+struct digital_t {
+	uint pin;
+	bool invert;
+	int  debounce;
+	bool prev;	// debounced
 
-void digital_new(struct digital_t **ptr, uint pin, int type);
-void digital_update(struct digital_t *ptr);
+	// Before debouncing
+	bool    raw;
+	us_t    raw_at;
+	us_t    locked_until;	// DIGITAL_DEBOUNCE_LOCKOUT
+	uint8_t count;		// DIGITAL_DEBOUNCE_INTEGRATOR
 
+	// Read from the main thread too: a sequence lock, odd while the tick
+	// writes them
+	uint32_t _Atomic stamps;
+	struct digital_stamp_t held_since;
+	struct digital_stamp_t released_at;
+
+#if DIGITAL_EDGE_IRQ
+	// Pushed by the GPIO interrupt, popped by the tick
+	struct digital_edge_t edges[DIGITAL_EDGE_RING_SIZE];
+	uint32_t _Atomic head;
+	uint32_t _Atomic tail;
+#endif
+
+	// External, flags read from any context
+	bool _Atomic trap;
+	bool _Atomic went_true;
+	bool _Atomic went_false;
+	ms_t _Atomic held_for;
+};
+
+void digital_init(struct digital_t *ptr, uint pin, int type, int debounce);
+
+// Every input, from the timer callback
+void digital_bank_update(void);
+
+#if DIGITAL_EDGE_IRQ
+/*
+ * digital_on_edge:
+ *
+ * Call handler from the GPIO interrupt after every edge it queues, to act
+ * on a press then rather than at the next tick. Set it once everything it
+ * uses exists. The GPIO interrupt and the timer callback are both at
+ * PICO_DEFAULT_IRQ_PRIORITY and don't preempt each other, the handler may
+ * do what the timer callback does.
+ */
+void digital_on_edge(void (*handler)(void));
+
+/*
+ * digital_bank_edges:
+ *
+ * The queued edges only, for that handler. NONE and LOCKOUT inputs switch
+ * right away; INTEGRATOR and VERTICAL still wait for their ticks.
+ */
+void digital_bank_edges(void);
+#endif
+
+// Debounced, as of the last update
 bool digital_now(struct digital_t *ptr);
 
+// Drop transitions not consumed yet
+void digital_discard(struct digital_t *ptr);
+
 /*
  * digital_trap:
  *
@@ -41,6 +132,15 @@ bool digital_went_true(struct digital_t *ptr);
  */
 bool digital_went_false(struct digital_t *ptr);
 
+// Time of the last debounced transition to true, to false
+us_t digital_pressed_at(struct digital_t *ptr);
+us_t digital_released_at(struct digital_t *ptr);
+
+/*
+ * digital_held_true:
+ *
+ * Was it last true for at_least ms (1000 or more), edge to edge?
+ */
 bool digital_held_true(struct digital_t *ptr, ms_t at_least);
 
 #endif /* HAPTIC_BRACELET_FIRMWARE_DIGITAL_H */
\ No newline at end of file
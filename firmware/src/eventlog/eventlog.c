@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/btstack_flash_bank.h"
+#include "pico/flash.h"
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "counter.h"
+#include "eventlog.h"
+#include "service.h"
+
+// Right below BTstack's pairing keys, which take the last sectors
+#define EVENTLOG_FLASH_OFFSET (PICO_FLASH_BANK_STORAGE_OFFSET - EVENTLOG_FLASH_SIZE)
+#define EVENTLOG_PAGES        (EVENTLOG_FLASH_SIZE / FLASH_PAGE_SIZE)
+#define EVENTLOG_SECTORS      (EVENTLOG_FLASH_SIZE / FLASH_SECTOR_SIZE)
+
+#define EVENTLOG_ERASED 0xff
+
+struct eventlog_record_t {
+	uint32_t us;
+	uint8_t  type;
+	uint8_t  source;
+	uint16_t value;
+};
+
+_Static_assert(sizeof(struct eventlog_record_t) == 8, "eventlog records are 8 bytes");
+_Static_assert(EVENTLOG_FLASH_OFFSET + EVENTLOG_FLASH_SIZE <= PICO_FLASH_BANK_STORAGE_OFFSET
+	|| EVENTLOG_FLASH_OFFSET >= PICO_FLASH_BANK_STORAGE_OFFSET + PICO_FLASH_BANK_TOTAL_SIZE,
+	"eventlog overlaps the BTstack flash bank");
+
+#define EVENTLOG_PAGE_RECORDS (FLASH_PAGE_SIZE / sizeof(struct eventlog_record_t))
+
+struct eventlog_page_t {
+	struct eventlog_record_t records[EVENTLOG_PAGE_RECORDS];
+};
+
+// Filled by eventlog_add() with interrupts off, written by the service
+static struct eventlog_page_t eventlog_pages[EVENTLOG_RAM_PAGES];
+static volatile size_t   eventlog_head = 0;	// page being filled
+static volatile size_t   eventlog_tail = 0;	// next page to write
+static volatile size_t   eventlog_fill = 0;	// records in the head page
+static volatile uint32_t eventlog_epoch = 0;
+static volatile uint32_t eventlog_lost = 0;
+
+// Service context
+static volatile size_t eventlog_flash_pages = 0;	// whole pages written
+static volatile size_t eventlog_flash_partial = 0;	// bytes of the next one
+static volatile bool   eventlog_flush_requested = false;
+static volatile bool   eventlog_erasing = false;
+static size_t          eventlog_erase_next = 0;
+
+static inline const uint8_t *eventlog_flash(size_t offset)
+{
+	return (const uint8_t *)(XIP_BASE + EVENTLOG_FLASH_OFFSET + offset);
+}
+
+struct eventlog_program_t {
+	size_t offset;
+	const void *data;
+};
+
+static void eventlog_program(void *param)
+{
+	struct eventlog_program_t *program = param;
+	flash_range_program(EVENTLOG_FLASH_OFFSET + program->offset, program->data, FLASH_PAGE_SIZE);
+}
+
+static void eventlog_erase_sector(void *param)
+{
+	size_t sector = *(size_t *)param;
+	flash_range_erase(EVENTLOG_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+}
+
+static inline bool eventlog_write_page(size_t index, const struct eventlog_page_t *page)
+{
+	struct eventlog_program_t program = {
+		.offset = index * FLASH_PAGE_SIZE,
+		.data   = page
+	};
+	return flash_safe_execute(eventlog_program, &program, EVENTLOG_FLASH_TIMEOUT_MS) == PICO_OK;
+}
+
+static void eventlog_service(void)
+{
+	if (eventlog_erasing) {
+		if (eventlog_erase_next < EVENTLOG_SECTORS) {
+			size_t sector = eventlog_erase_next;
+			if (flash_safe_execute(eventlog_erase_sector, &sector, EVENTLOG_FLASH_TIMEOUT_MS) == PICO_OK)
+				eventlog_erase_next++;
+			service_request(); // next sector on the next run
+			return;
+		}
+
+		eventlog_flash_pages = 0;
+		eventlog_flash_partial = 0;
+		eventlog_erasing = false;
+	}
+
+	while (eventlog_tail != eventlog_head) {
+		size_t tail = eventlog_tail;
+		if (eventlog_flash_pages >= EVENTLOG_PAGES) {
+			eventlog_lost += EVENTLOG_PAGE_RECORDS;
+			counter_add(counter_eventlog_dropped, EVENTLOG_PAGE_RECORDS);
+		} else if (eventlog_write_page(eventlog_flash_pages, &(eventlog_pages[tail]))) {
+			eventlog_flash_pages++;
+			eventlog_flash_partial = 0;
+		} else {
+			return; // try again on the next run
+		}
+		eventlog_tail = (tail + 1) % EVENTLOG_RAM_PAGES;
+	}
+
+	if (!eventlog_flush_requested)
+		return;
+
+	// The rest of the page stays erased, the whole page is written again once full
+	if (eventlog_flash_pages < EVENTLOG_PAGES) {
+		static struct eventlog_page_t page;
+
+		uint32_t irq = save_and_disable_interrupts();
+		size_t fill = eventlog_fill;
+		memcpy(&page, &(eventlog_pages[eventlog_head]), fill * sizeof(struct eventlog_record_t));
+		restore_interrupts(irq);
+
+		memset(&(page.records[fill]), EVENTLOG_ERASED, (EVENTLOG_PAGE_RECORDS - fill) * sizeof(struct eventlog_record_t));
+		if (fill > 0 && !eventlog_write_page(eventlog_flash_pages, &page))
+			return;
+
+		eventlog_flash_partial = fill * sizeof(struct eventlog_record_t);
+	}
+	eventlog_flush_requested = false;
+}
+
+// Interrupts off
+static inline bool eventlog_next_page(void)
+{
+	size_t head_next = (eventlog_head + 1) % EVENTLOG_RAM_PAGES;
+	if (head_next == eventlog_tail)
+		return false;
+
+	eventlog_head = head_next;
+	eventlog_fill = 0;
+	service_request();
+	return true;
+}
+
+static inline void eventlog_append(uint32_t us, uint8_t type, uint8_t source, uint16_t value)
+{
+	struct eventlog_record_t *record = &(eventlog_pages[eventlog_head].records[eventlog_fill]);
+	record->us     = us;
+	record->type   = type;
+	record->source = source;
+	record->value  = value;
+	eventlog_fill++;
+}
+
+static inline bool eventlog_put(us_t now, uint8_t type, uint8_t source, uint16_t value)
+{
+	uint32_t epoch = now >> 32;
+
+	if (eventlog_fill >= EVENTLOG_PAGE_RECORDS && !eventlog_next_page())
+		return false;
+
+	// Pages must stand on their own: each starts with the high word
+	if (eventlog_fill == 0 || epoch != eventlog_epoch) {
+		eventlog_append(epoch, eventlog_time, eventlog_device, 0);
+		eventlog_epoch = epoch;
+
+		if (eventlog_fill >= EVENTLOG_PAGE_RECORDS) {
+			if (!eventlog_next_page())
+				return false;
+			eventlog_append(epoch, eventlog_time, eventlog_device, 0);
+		}
+	}
+
+	eventlog_append((uint32_t)now, type, source, value);
+	return true;
+}
+
+void eventlog_add(uint8_t type, uint8_t source, uint16_t value)
+{
+	us_t now = us_now();
+
+	uint32_t irq = save_and_disable_interrupts();
+	if (eventlog_erasing || !eventlog_put(now, type, source, value)) {
+		eventlog_lost++;
+		counter_increment(counter_eventlog_dropped);
+	}
+	restore_interrupts(irq);
+}
+
+void eventlog_flush(void)
+{
+	eventlog_flush_requested = true;
+	service_request();
+}
+
+void eventlog_erase(void)
+{
+	uint32_t irq = save_and_disable_interrupts();
+	eventlog_erasing = true;
+	eventlog_erase_next = 0;
+	eventlog_flush_requested = false;
+	eventlog_head = eventlog_tail;
+	eventlog_fill = 0;
+	restore_interrupts(irq);
+
+	service_request();
+}
+
+bool eventlog_busy(void)
+{
+	return eventlog_erasing || eventlog_flush_requested;
+}
+
+size_t eventlog_size(void)
+{
+	if (eventlog_erasing)
+		return 0;
+
+	return eventlog_flash_pages * FLASH_PAGE_SIZE + eventlog_flash_partial;
+}
+
+size_t eventlog_capacity(void)
+{
+	return EVENTLOG_FLASH_SIZE;
+}
+
+uint32_t eventlog_dropped(void)
+{
+	return eventlog_lost;
+}
+
+size_t eventlog_read(size_t offset, uint8_t *buffer, size_t size)
+{
+	size_t end = eventlog_size();
+	if (offset >= end)
+		return 0;
+
+	if (size > end - offset)
+		size = end - offset;
+
+	memcpy(buffer, eventlog_flash(offset), size);
+	return size;
+}
+
+// Pages are written in order: find the first one still erased
+static inline size_t eventlog_find_end(void)
+{
+	size_t low = 0;
+	size_t high = EVENTLOG_PAGES;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		const struct eventlog_record_t *first = (const struct eventlog_record_t *)eventlog_flash(middle * FLASH_PAGE_SIZE);
+		if (first->type == EVENTLOG_ERASED)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+void eventlog_init(void)
+{
+	eventlog_flash_pages = eventlog_find_end();
+	eventlog_flash_partial = 0;
+
+	// A half written page from before the reset stays as is, start a new one
+	eventlog_head = 0;
+	eventlog_tail = 0;
+	eventlog_fill = 0;
+
+	service_init();
+	service_add(eventlog_service);
+	eventlog_add(eventlog_boot, eventlog_device, 0);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_EVENTLOG_H
+#define HAPTIC_BRACELET_FIRMWARE_EVENTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * Event log:
+ *
+ * Ground truth timing for studies. Every command received, pulse run and
+ * aux input is kept as an 8 byte record in a reserved region near the end
+ * of flash (EVENTLOG_FLASH_SIZE, below the BTstack pairing keys), written
+ * a page at a time from the service context. The log is only erased on
+ * request.
+ *
+ * Record, little endian:
+ *   uint32_t us      low word of us_now()
+ *   uint8_t  type    enum eventlog_type
+ *   uint8_t  source  enum eventlog_source
+ *   uint16_t value   pulse ms, ADC reading, ...
+ *
+ * Every page starts with an eventlog_time record, whose us field is the
+ * high word of us_now(). Records of type 0xff are unwritten, skip them.
+ */
+
+enum eventlog_type {
+	eventlog_time      = 1,
+	eventlog_boot      = 2,
+	eventlog_command   = 3,	// pulse received
+	eventlog_scheduled = 4,	// pulse received for later
+	eventlog_pulse     = 5,	// pulse started
+	eventlog_aux_down  = 6,
+	eventlog_aux_up    = 7,
+	eventlog_aux_move  = 8,
+	eventlog_aux_click = 9,	// knob detent, value the detent index
+	eventlog_aux_wall  = 10,	// knob end stop, value the ADC reading
+	eventlog_aux_gesture = 11	// aux button, value the enum gesture_type
+};
+
+enum eventlog_source {
+	eventlog_device    = 0,
+	eventlog_bluetooth = 1,
+	eventlog_usb       = 2
+};
+
+void eventlog_init(void);
+
+/*
+ * eventlog_add:
+ *
+ * Timestamped now. Safe from any context, dropped (and counted) if the
+ * page buffers are full or the flash region is.
+ */
+void eventlog_add(uint8_t type, uint8_t source, uint16_t value);
+
+/*
+ * eventlog_flush:
+ *
+ * Write the page being filled too, so that a download gets everything.
+ */
+void eventlog_flush(void);
+
+/*
+ * eventlog_erase:
+ *
+ * Erase the region, a sector per service run. Interrupts are off for the
+ * length of each sector erase, only do this between sessions.
+ */
+void eventlog_erase(void);
+
+/*
+ * eventlog_busy:
+ *
+ * Is a flush or an erase still pending?
+ */
+bool eventlog_busy(void);
+
+// Bytes in flash, readable with eventlog_read()
+size_t eventlog_size(void);
+size_t eventlog_capacity(void);
+uint32_t eventlog_dropped(void);
+
+size_t eventlog_read(size_t offset, uint8_t *buffer, size_t size);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_EVENTLOG_H */
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+#include "filter.h"
+
+/*
+ * One channel
+ */
+
+void filter_ema_init(struct filter_ema_t *ptr, uint8_t shift, int32_t value)
+{
+	ptr->shift = shift;
+	ptr->state = value * (1 << shift);
+}
+
+int32_t filter_ema(struct filter_ema_t *ptr, int32_t x)
+{
+	ptr->state += x - (ptr->state >> ptr->shift);
+	return ptr->state >> ptr->shift;
+}
+
+static inline int32_t filter_min(int32_t a, int32_t b)
+{
+	return (a < b) ? a : b;
+}
+
+static inline int32_t filter_max(int32_t a, int32_t b)
+{
+	return (a > b) ? a : b;
+}
+
+void filter_median3_init(struct filter_median3_t *ptr, int32_t value)
+{
+	ptr->x1 = value;
+	ptr->x2 = value;
+}
+
+int32_t filter_median3(struct filter_median3_t *ptr, int32_t x)
+{
+	int32_t a = ptr->x2;
+	int32_t b = ptr->x1;
+	ptr->x2 = b;
+	ptr->x1 = x;
+
+	return filter_max(filter_min(a, b), filter_min(filter_max(a, b), x));
+}
+
+static inline int32_t filter_q(double value)
+{
+	return (int32_t)lround(value * (1 << FILTER_Q));
+}
+
+void filter_biquad_lowpass(struct filter_biquad_t *ptr, uint32_t cutoff_hz, uint32_t sample_hz, int32_t value)
+{
+	// RBJ cookbook
+	double w0 = 2 * M_PI * cutoff_hz / sample_hz;
+	double alpha = sin(w0) / (2 * M_SQRT1_2);
+	double a0 = 1 + alpha;
+
+	ptr->b0 = filter_q((1 - cos(w0)) / 2 / a0);
+	ptr->b1 = filter_q((1 - cos(w0)) / a0);
+	ptr->b2 = ptr->b0;
+	ptr->a1 = filter_q(-2 * cos(w0) / a0);
+	ptr->a2 = filter_q((1 - alpha) / a0);
+
+	// Settled at value
+	ptr->x1 = ptr->x2 = value * (1 << FILTER_BIQUAD_HEADROOM);
+	ptr->y1 = ptr->y2 = ptr->x1;
+	ptr->error = 0;
+}
+
+int32_t filter_biquad(struct filter_biquad_t *ptr, int32_t x)
+{
+	x *= 1 << FILTER_BIQUAD_HEADROOM;
+
+	int64_t acc = (int64_t)ptr->b0 * x
+		+ (int64_t)ptr->b1 * ptr->x1
+		+ (int64_t)ptr->b2 * ptr->x2
+		- (int64_t)ptr->a1 * ptr->y1
+		- (int64_t)ptr->a2 * ptr->y2
+		+ ptr->error;
+
+	int32_t y = (int32_t)(acc >> FILTER_Q);
+	ptr->error = (int32_t)(acc - ((int64_t)y << FILTER_Q));
+
+	ptr->x2 = ptr->x1;
+	ptr->x1 = x;
+	ptr->y2 = ptr->y1;
+	ptr->y1 = y;
+
+	return (y + (1 << (FILTER_BIQUAD_HEADROOM - 1))) >> FILTER_BIQUAD_HEADROOM;
+}
+
+static inline int32_t filter_tracker_q(double value)
+{
+	return (int32_t)lround(value * (1 << FILTER_TRACKER_Q));
+}
+
+static inline int32_t filter_tracker_gain(int32_t gain, int32_t residual)
+{
+	int64_t product = (int64_t)gain * residual;
+	return (int32_t)((product + (1 << (FILTER_TRACKER_Q - 1))) >> FILTER_TRACKER_Q);
+}
+
+void filter_tracker_init(struct filter_tracker_t *ptr, uint32_t ticks, int32_t value)
+{
+	// Fading memory (Brookner)
+	double theta = 1 - 1.0 / ticks;
+	double rest = 1 - theta;
+
+	ptr->g = filter_tracker_q(1 - theta * theta * theta);
+	ptr->h = filter_tracker_q(1.5 * rest * rest * (1 + theta));
+	ptr->k = filter_tracker_q(0.5 * rest * rest * rest);
+
+	ptr->x = value * (1 << FILTER_TRACKER_FRACTION);
+	ptr->v = 0;
+	ptr->a = 0;
+}
+
+void filter_tracker(struct filter_tracker_t *ptr, int32_t x)
+{
+	// Predict one sample on
+	int32_t position = ptr->x + ptr->v + ptr->a / 2;
+	int32_t velocity = ptr->v + ptr->a;
+
+	int32_t residual = x * (1 << FILTER_TRACKER_FRACTION) - position;
+
+	ptr->x = position + filter_tracker_gain(ptr->g, residual);
+	ptr->v = velocity + filter_tracker_gain(ptr->h, residual);
+	ptr->a = ptr->a   + filter_tracker_gain(ptr->k, residual);
+}
+
+/*
+ * Two channels, SIMD or not
+ */
+
+#if defined(__ARM_FEATURE_SIMD32)
+
+static inline uint32_t filter_sub16(uint32_t a, uint32_t b)
+{
+	return (uint32_t)__qsub16((int16x2_t)a, (int16x2_t)b);
+}
+
+static inline uint32_t filter_add16(uint32_t a, uint32_t b)
+{
+	return (uint32_t)__qadd16((int16x2_t)a, (int16x2_t)b);
+}
+
+// The GE flags from the subtraction pick the lanes
+static inline uint32_t filter_min16(uint32_t a, uint32_t b)
+{
+	__ssub16((int16x2_t)a, (int16x2_t)b);
+	return (uint32_t)__sel((uint8x4_t)b, (uint8x4_t)a);
+}
+
+static inline uint32_t filter_max16(uint32_t a, uint32_t b)
+{
+	__ssub16((int16x2_t)a, (int16x2_t)b);
+	return (uint32_t)__sel((uint8x4_t)a, (uint8x4_t)b);
+}
+
+#else
+
+static inline uint32_t filter_lanes(int32_t low, int32_t high)
+{
+	return filter_pack((int16_t)low, (int16_t)high);
+}
+
+static inline int32_t filter_saturate16(int32_t value)
+{
+	return (value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value;
+}
+
+static inline uint32_t filter_sub16(uint32_t a, uint32_t b)
+{
+	return filter_lanes(filter_saturate16(filter_low(a) - filter_low(b)),
+		filter_saturate16(filter_high(a) - filter_high(b)));
+}
+
+static inline uint32_t filter_add16(uint32_t a, uint32_t b)
+{
+	return filter_lanes(filter_saturate16(filter_low(a) + filter_low(b)),
+		filter_saturate16(filter_high(a) + filter_high(b)));
+}
+
+static inline uint32_t filter_min16(uint32_t a, uint32_t b)
+{
+	return filter_lanes(filter_min(filter_low(a), filter_low(b)), filter_min(filter_high(a), filter_high(b)));
+}
+
+static inline uint32_t filter_max16(uint32_t a, uint32_t b)
+{
+	return filter_lanes(filter_max(filter_low(a), filter_low(b)), filter_max(filter_high(a), filter_high(b)));
+}
+
+#endif
+
+// Arithmetic shift right of each lane
+static inline uint32_t filter_shift16(uint32_t value, uint8_t shift)
+{
+	uint32_t high = (uint32_t)((int32_t)(value & 0xffff0000) >> shift) & 0xffff0000;
+	uint32_t low  = (uint32_t)((int32_t)(value << 16) >> (16 + shift)) & 0xffff;
+	return high | low;
+}
+
+void filter_ema_x2_init(struct filter_ema_x2_t *ptr, uint8_t shift, uint32_t value)
+{
+	ptr->shift = shift;
+	ptr->state = filter_pack(filter_low(value) << FILTER_EMA_X2_FRACTION,
+		filter_high(value) << FILTER_EMA_X2_FRACTION);
+}
+
+uint32_t filter_ema_x2(struct filter_ema_x2_t *ptr, uint32_t x)
+{
+	uint32_t scaled = filter_pack(filter_low(x) << FILTER_EMA_X2_FRACTION,
+		filter_high(x) << FILTER_EMA_X2_FRACTION);
+
+	uint32_t step = filter_shift16(filter_sub16(scaled, ptr->state), ptr->shift);
+	ptr->state = filter_add16(ptr->state, step);
+
+	return filter_shift16(ptr->state, FILTER_EMA_X2_FRACTION);
+}
+
+void filter_median3_x2_init(struct filter_median3_x2_t *ptr, uint32_t value)
+{
+	ptr->x1 = value;
+	ptr->x2 = value;
+}
+
+uint32_t filter_median3_x2(struct filter_median3_x2_t *ptr, uint32_t x)
+{
+	uint32_t a = ptr->x2;
+	uint32_t b = ptr->x1;
+	ptr->x2 = b;
+	ptr->x1 = x;
+
+	return filter_max16(filter_min16(a, b), filter_min16(filter_max16(a, b), x));
+}
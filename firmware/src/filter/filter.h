@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_FILTER_H
+#define HAPTIC_BRACELET_FIRMWARE_FILTER_H
+
+#include <stdint.h>
+
+/*
+ * Filters:
+ *
+ * Fixed point, a few bytes of state each, for ADC readings (12 bits) taken
+ * once per tick. The state is embedded in the owner's struct, no malloc.
+ *
+ * The _x2 variants filter two channels at once, packed as two signed 16
+ * bit lanes (low lane first channel). On the Cortex-M33 they use the DSP
+ * SIMD instructions, elsewhere plain C that gives the same results.
+ */
+
+/*
+ * struct filter_ema_t:
+ *
+ * One pole low-pass, y += (x - y) / 2^shift. Time constant about 2^shift
+ * samples. The state keeps shift extra bits, so there is no dead band.
+ */
+struct filter_ema_t {
+	int32_t state;
+	uint8_t shift;
+};
+
+void filter_ema_init(struct filter_ema_t *ptr, uint8_t shift, int32_t value);
+int32_t filter_ema(struct filter_ema_t *ptr, int32_t x);
+
+/*
+ * struct filter_median3_t:
+ *
+ * Median of the last 3 samples, drops single sample spikes. One sample of
+ * delay.
+ */
+struct filter_median3_t {
+	int32_t x1;
+	int32_t x2;
+};
+
+void filter_median3_init(struct filter_median3_t *ptr, int32_t value);
+int32_t filter_median3(struct filter_median3_t *ptr, int32_t x);
+
+/*
+ * struct filter_biquad_t:
+ *
+ * Second order section, direct form I. Q14 coefficients, 64 bit
+ * accumulator, input and state scaled up by FILTER_BIQUAD_HEADROOM bits.
+ * The rounding error is fed back into the next sample, or low cutoffs
+ * would settle a few counts off.
+ */
+#define FILTER_Q              14
+#define FILTER_BIQUAD_HEADROOM 4
+
+struct filter_biquad_t {
+	int32_t b0, b1, b2;
+	int32_t a1, a2;
+	int32_t x1, x2;
+	int32_t y1, y2;
+	int32_t error;
+};
+
+/*
+ * filter_biquad_lowpass:
+ *
+ * Butterworth (Q = 0.707) low-pass, cutoff_hz < sample_hz / 2. Floating
+ * point, call at init only.
+ */
+void filter_biquad_lowpass(struct filter_biquad_t *ptr, uint32_t cutoff_hz, uint32_t sample_hz, int32_t value);
+int32_t filter_biquad(struct filter_biquad_t *ptr, int32_t x);
+
+/*
+ * struct filter_tracker_t:
+ *
+ * Alpha-beta-gamma tracker, position, velocity and acceleration from the
+ * position alone. Fading memory gains: theta = 1 - 1 / ticks, so about
+ * ticks samples count. State in Q16 ADC counts per sample (squared),
+ * gains in Q24.
+ */
+#define FILTER_TRACKER_FRACTION 16
+#define FILTER_TRACKER_Q        24
+
+struct filter_tracker_t {
+	int32_t g, h, k;	// position, velocity, acceleration gains
+	int32_t x, v, a;
+};
+
+/*
+ * filter_tracker_init:
+ *
+ * ticks >= 2. Floating point, call at init only. Starts still at value.
+ */
+void filter_tracker_init(struct filter_tracker_t *ptr, uint32_t ticks, int32_t value);
+void filter_tracker(struct filter_tracker_t *ptr, int32_t x);
+
+// Per sample, and per sample squared, Q16
+static inline int32_t filter_tracker_velocity(const struct filter_tracker_t *ptr)
+{
+	return ptr->v;
+}
+
+static inline int32_t filter_tracker_acceleration(const struct filter_tracker_t *ptr)
+{
+	return ptr->a;
+}
+
+/*
+ * Two channels
+ */
+
+static inline uint32_t filter_pack(int16_t low, int16_t high)
+{
+	return (uint16_t)low | ((uint32_t)(uint16_t)high << 16);
+}
+
+static inline int16_t filter_low(uint32_t packed)
+{
+	return (int16_t)(packed & 0xffff);
+}
+
+static inline int16_t filter_high(uint32_t packed)
+{
+	return (int16_t)(packed >> 16);
+}
+
+/*
+ * struct filter_ema_x2_t:
+ *
+ * filter_ema_t for two channels. The lanes keep 3 extra bits, so inputs
+ * have to fit in 12 bits, and the dead band is 2^shift / 8.
+ */
+#define FILTER_EMA_X2_FRACTION 3
+
+struct filter_ema_x2_t {
+	uint32_t state;
+	uint8_t shift;
+};
+
+void filter_ema_x2_init(struct filter_ema_x2_t *ptr, uint8_t shift, uint32_t value);
+uint32_t filter_ema_x2(struct filter_ema_x2_t *ptr, uint32_t x);
+
+struct filter_median3_x2_t {
+	uint32_t x1;
+	uint32_t x2;
+};
+
+void filter_median3_x2_init(struct filter_median3_x2_t *ptr, uint32_t value);
+uint32_t filter_median3_x2(struct filter_median3_x2_t *ptr, uint32_t x);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_FILTER_H */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "digital.h"
+#include "gesture.h"
+
+#define GESTURE_LONG_US   ((us_t)GESTURE_LONG_MS * 1000)
+#define GESTURE_DOUBLE_US ((us_t)GESTURE_DOUBLE_MS * 1000)
+#define GESTURE_REPEAT_US ((us_t)GESTURE_REPEAT_MS * 1000)
+
+enum gesture_state {
+	gesture_idle,
+	gesture_pressed,	// first press
+	gesture_released,	// clicked, a second press would make a double
+	gesture_pressed_again,
+	gesture_held		// past GESTURE_LONG_MS
+};
+
+void gesture_init(struct gesture_t *ptr, struct digital_t *input)
+{
+	ptr->input = input;
+	ptr->state = gesture_idle;
+	ptr->pressed = 0;
+	ptr->released = 0;
+	ptr->repeat_at = 0;
+	ptr->count = 0;
+	ptr->head = 0;
+	ptr->tail = 0;
+}
+
+static inline void gesture_emit(struct gesture_t *ptr, uint8_t type, us_t at)
+{
+	if (ptr->head - ptr->tail >= GESTURE_QUEUE_SIZE)
+		return;
+
+	struct gesture_event_t *event = &(ptr->queue[ptr->head % GESTURE_QUEUE_SIZE]);
+	event->type  = type;
+	event->count = ptr->count;
+	event->held  = (at - ptr->pressed) / 1000;
+	event->at    = at;
+	ptr->head++;
+}
+
+// What time alone decides, up to at
+static inline void gesture_expire(struct gesture_t *ptr, us_t at)
+{
+	switch (ptr->state) {
+		case gesture_pressed:
+		case gesture_pressed_again:
+			if (at < ptr->pressed + GESTURE_LONG_US)
+				break;
+			ptr->state = gesture_held;
+			ptr->count = 0;
+			ptr->repeat_at = ptr->pressed + GESTURE_LONG_US + GESTURE_REPEAT_US;
+			gesture_emit(ptr, gesture_long, ptr->pressed + GESTURE_LONG_US);
+			// fall through
+
+		case gesture_held:
+			while (at >= ptr->repeat_at) {
+				ptr->count++;
+				gesture_emit(ptr, gesture_repeat, ptr->repeat_at);
+				ptr->repeat_at += GESTURE_REPEAT_US;
+			}
+			break;
+
+		case gesture_released:
+			if (at <= ptr->released + GESTURE_DOUBLE_US)
+				break;
+			ptr->state = gesture_idle;
+			gesture_emit(ptr, gesture_single, ptr->released + GESTURE_DOUBLE_US);
+			break;
+
+		default:
+			break;
+	}
+}
+
+static inline void gesture_press(struct gesture_t *ptr, us_t at)
+{
+	gesture_expire(ptr, at);
+
+	ptr->state = (ptr->state == gesture_released) ? gesture_pressed_again : gesture_pressed;
+	ptr->pressed = at;
+	ptr->count = 0;
+	gesture_emit(ptr, gesture_down, at);
+}
+
+static inline void gesture_release(struct gesture_t *ptr, us_t at)
+{
+	gesture_expire(ptr, at);
+	gesture_emit(ptr, gesture_up, at);
+
+	switch (ptr->state) {
+		case gesture_pressed:
+			ptr->state = gesture_released;
+			ptr->released = at;
+			gesture_emit(ptr, gesture_click, at);
+			break;
+
+		case gesture_pressed_again:
+			ptr->state = gesture_idle;
+			gesture_emit(ptr, gesture_double, at);
+			break;
+
+		default:
+			ptr->state = gesture_idle;
+			break;
+	}
+}
+
+void gesture_update(struct gesture_t *ptr, us_t now)
+{
+	bool down = digital_went_true(ptr->input);
+	bool up   = digital_went_false(ptr->input);
+	us_t pressed  = digital_pressed_at(ptr->input);
+	us_t released = digital_released_at(ptr->input);
+
+	// Both since the last tick, in the order they happened
+	if (down && up && released < pressed) {
+		gesture_release(ptr, released);
+		gesture_press(ptr, pressed);
+	} else {
+		if (down)
+			gesture_press(ptr, pressed);
+		if (up)
+			gesture_release(ptr, released);
+	}
+
+	gesture_expire(ptr, now);
+}
+
+bool gesture_pop(struct gesture_t *ptr, struct gesture_event_t *event)
+{
+	if (ptr->tail == ptr->head)
+		return false;
+
+	*event = ptr->queue[ptr->tail % GESTURE_QUEUE_SIZE];
+	ptr->tail++;
+	return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_GESTURE_H
+#define HAPTIC_BRACELET_FIRMWARE_GESTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config_adv.h"
+#include "digital.h"
+
+/*
+ * struct gesture_t:
+ *
+ * Clicks, double clicks, long presses and hold-repeat from a button's
+ * debounced edges, timed from the edges themselves (GESTURE_*_MS).
+ *
+ * Nothing waits to be sure: gesture_down goes out on the press and
+ * gesture_click on the release, before a double click could be ruled
+ * out. If a second press follows within GESTURE_DOUBLE_MS, gesture_double
+ * comes after the click, else gesture_single confirms it. React to click
+ * for speed, to single when a double would mean something else.
+ *
+ * Takes over the button's went_true/went_false. Embedded in the owner,
+ * updated and read from the timer callback.
+ */
+
+enum gesture_type {
+	gesture_down,	// pressed
+	gesture_up,	// released
+	gesture_click,	// released before GESTURE_LONG_MS, maybe the first of a double
+	gesture_single,	// the click wasn't followed by another
+	gesture_double,	// second click within GESTURE_DOUBLE_MS of the first
+	gesture_long,	// held for GESTURE_LONG_MS
+	gesture_repeat	// still held, every GESTURE_REPEAT_MS after that
+};
+
+struct gesture_event_t {
+	uint8_t type;	// enum gesture_type
+	uint16_t count;	// repeats so far
+	ms_t held;	// since the press, for up, long and repeat
+	us_t at;	// when it happened, edges to the us
+};
+
+struct gesture_t {
+	struct digital_t *input;
+	int state;	// enum gesture_state, in gesture.c
+
+	us_t pressed;
+	us_t released;
+	us_t repeat_at;
+	uint16_t count;
+
+	struct gesture_event_t queue[GESTURE_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+};
+
+void gesture_init(struct gesture_t *ptr, struct digital_t *input);
+
+// Once per tick, after digital_bank_update()
+void gesture_update(struct gesture_t *ptr, us_t now);
+
+/*
+ * gesture_pop:
+ *
+ * Oldest event not consumed, false if none. Up to GESTURE_QUEUE_SIZE are
+ * kept, later ones are dropped.
+ */
+bool gesture_pop(struct gesture_t *ptr, struct gesture_event_t *event);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_GESTURE_H */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "intensity.h"
+
+void intensity_init(struct intensity_t *ptr, struct intensity_parameters_t parameters)
+{
+	ptr->parameters = parameters;
+	ptr->budget_max = parameters.duty_percent * parameters.window_ms;
+	ptr->budget     = ptr->budget_max;
+	ptr->refilled   = ms_now();
+}
+
+static inline void intensity_refill(struct intensity_t *ptr, ms_t now)
+{
+	// A whole window fills it, and more would wrap the product (~30 h)
+	ms_t elapsed = now - ptr->refilled;
+	if (elapsed > ptr->parameters.window_ms)
+		elapsed = ptr->parameters.window_ms;
+
+	uint32_t gained = elapsed * ptr->parameters.duty_percent;
+	ptr->refilled = now;
+
+	if (gained > ptr->budget_max - ptr->budget)
+		ptr->budget = ptr->budget_max;
+	else
+		ptr->budget += gained;
+}
+
+// Linear from low to high as speed goes from speed_min to speed_max
+static inline int32_t intensity_map(const struct intensity_parameters_t *parameters,
+	int64_t speed, int32_t low, int32_t high)
+{
+	if (speed <= parameters->speed_min)
+		return low;
+	if (speed >= parameters->speed_max)
+		return high;
+
+	int64_t span = parameters->speed_max - parameters->speed_min;
+	return low + (int32_t)((speed - parameters->speed_min) * (high - low) / span);
+}
+
+bool intensity_pulse(struct intensity_t *ptr, int32_t velocity, int32_t acceleration,
+	ms_t now, ms_t *ms, pwm_t *pwm)
+{
+	struct intensity_parameters_t *parameters = &(ptr->parameters);
+
+	// Speeding up counts ahead, slowing down doesn't
+	int64_t speed = abs(velocity);
+	int64_t lead  = (int64_t)acceleration * parameters->lead_ms / 1000;
+	if ((velocity >= 0) == (lead >= 0))
+		speed += llabs(lead);
+
+	ms_t length = intensity_map(parameters, speed, parameters->ms_min, parameters->ms_max);
+	*pwm = intensity_map(parameters, speed, parameters->pwm_min, parameters->pwm_max);
+
+	intensity_refill(ptr, now);
+	if (ptr->budget < length * 100)
+		length = ptr->budget / 100;
+	if (length < parameters->ms_min)
+		return false;
+
+	ptr->budget -= length * 100;
+	*ms = length;
+	return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_INTENSITY_H
+#define HAPTIC_BRACELET_FIRMWARE_INTENSITY_H
+
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * struct intensity_t:
+ *
+ * Pulse length and strength from how fast the aux knob turns. The speed,
+ * led by the acceleration while it speeds up, maps linearly from the
+ * minimum pulse at speed_min to the maximum at speed_max, clamped.
+ *
+ * Fast spins are rate limited: the motor gets duty_percent of the time,
+ * averaged over window_ms. A pulse is shortened to what is left, or
+ * dropped if that is under ms_min.
+ *
+ * Embedded in the owner, used from the timer callback.
+ */
+struct intensity_parameters_t {
+	int32_t speed_min;	// ADC counts per second
+	int32_t speed_max;
+	ms_t    ms_min;
+	ms_t    ms_max;
+	pwm_t   pwm_min;
+	pwm_t   pwm_max;
+	ms_t    lead_ms;	// acceleration look ahead
+	uint    duty_percent;
+	ms_t    window_ms;
+};
+
+struct intensity_t {
+	struct intensity_parameters_t parameters;
+
+	// Token bucket, in ms of motor time * 100
+	uint32_t budget;
+	uint32_t budget_max;
+	ms_t     refilled;
+};
+
+void intensity_init(struct intensity_t *ptr, struct intensity_parameters_t parameters);
+
+/*
+ * intensity_pulse:
+ *
+ * velocity in ADC counts per second, acceleration per second squared,
+ * signed. False if the pulse is rate limited away. Called when a pulse
+ * starts.
+ */
+bool intensity_pulse(struct intensity_t *ptr, int32_t velocity, int32_t acceleration,
+	ms_t now, ms_t *ms, pwm_t *pwm);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_INTENSITY_H */
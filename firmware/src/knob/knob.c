@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "knob.h"
+
+void knob_init(struct knob_t *ptr, struct knob_parameters_t parameters,
+	const int32_t *positions, uint count, int32_t position)
+{
+	if (count > KNOB_DETENTS_MAX)
+		panic("knob: %u detents, raise KNOB_DETENTS_MAX", count);
+	memcpy(ptr->detents, positions, count * sizeof(int32_t));
+
+	ptr->parameters = parameters;
+	ptr->count = count;
+	ptr->walled = false;
+	ptr->wall_time = 0;
+	knob_reset(ptr, position, 0);
+}
+
+void knob_reset(struct knob_t *ptr, int32_t position, ms_t now)
+{
+	ptr->index = 0;
+	while (ptr->index < ptr->count && position >= ptr->detents[ptr->index])
+		ptr->index++;
+	ptr->pending = 0;
+
+	// Already against it, no buzz for getting there
+	struct knob_parameters_t *parameters = &(ptr->parameters);
+	if (position < parameters->wall_low || position > parameters->wall_high) {
+		ptr->walled = true;
+		ptr->wall_time = now;
+	} else {
+		ptr->walled = false;
+	}
+	ptr->wall_pending = false;
+}
+
+void knob_even(int32_t *positions, uint count, int32_t low, int32_t high)
+{
+	int64_t span = (int64_t)high - low;
+
+	for (uint i = 0; i < count; i++)
+		positions[i] = low + (int32_t)(span * (i + 1) / (count + 1));
+}
+
+static inline void knob_walls(struct knob_t *ptr, int32_t position, ms_t now)
+{
+	struct knob_parameters_t *parameters = &(ptr->parameters);
+
+	if (position < parameters->wall_low || position > parameters->wall_high) {
+		if (!ptr->walled || now - ptr->wall_time >= parameters->wall_repeat_ms) {
+			ptr->wall_pending = true;
+			ptr->wall_time = now;
+		}
+		ptr->walled = true;
+		return;
+	}
+
+	// Out of it by the hysteresis
+	if (position >= parameters->wall_low  + parameters->hysteresis &&
+	    position <= parameters->wall_high - parameters->hysteresis) {
+		ptr->walled = false;
+		ptr->wall_pending = false;
+	}
+}
+
+void knob_update(struct knob_t *ptr, int32_t position, ms_t now)
+{
+	int32_t hysteresis = ptr->parameters.hysteresis;
+	uint crossed = 0;
+
+	while (ptr->index < ptr->count && position >= ptr->detents[ptr->index] + hysteresis) {
+		ptr->index++;
+		crossed++;
+	}
+	while (ptr->index > 0 && position <= ptr->detents[ptr->index - 1] - hysteresis) {
+		ptr->index--;
+		crossed++;
+	}
+
+	ptr->pending += crossed;
+	if (ptr->pending > DETENT_PENDING_MAX)
+		ptr->pending = DETENT_PENDING_MAX;
+
+	knob_walls(ptr, position, now);
+}
+
+enum knob_effect knob_pop(struct knob_t *ptr)
+{
+	if (ptr->wall_pending) {
+		ptr->wall_pending = false;
+		return knob_wall;
+	}
+
+	if (ptr->pending == 0)
+		return knob_none;
+
+	ptr->pending--;
+	return knob_click;
+}
+
+uint knob_index(struct knob_t *ptr)
+{
+	return ptr->index;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_KNOB_H
+#define HAPTIC_BRACELET_FIRMWARE_KNOB_H
+
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * struct knob_t:
+ *
+ * Makes the aux potentiometer feel like a notched encoder, on its own.
+ * Clicks each time the filtered position crosses a detent, and buzzes
+ * against the end stops, like a wall.
+ *
+ * A detent is crossed once the position is past it by the hysteresis,
+ * so sitting on one doesn't chatter. Clicks owed after a fast turn are
+ * capped at DETENT_PENDING_MAX, like the streamed detents. Past a wall
+ * the buzz repeats, until the position is back inside by the hysteresis.
+ *
+ * Embedded in the owner. knob_update() and knob_pop() are both called
+ * from the timer callback.
+ */
+enum knob_effect {knob_none, knob_click, knob_wall};
+
+struct knob_parameters_t {
+	int32_t hysteresis;
+	int32_t wall_low;	// below this is a wall
+	int32_t wall_high;	// above this is a wall
+	ms_t    wall_repeat_ms;
+};
+
+struct knob_t {
+	struct knob_parameters_t parameters;
+
+	int32_t  detents[KNOB_DETENTS_MAX];
+	uint     count;
+	uint     index;		// detents below the position
+	uint32_t pending;	// clicks owed
+
+	bool     walled;	// past an end stop
+	bool     wall_pending;
+	ms_t     wall_time;	// last buzz
+};
+
+/*
+ * knob_init:
+ *
+ * count detents at positions, ascending, copied. More than
+ * KNOB_DETENTS_MAX panics. position is where the knob is now, it starts
+ * without clicking.
+ */
+void knob_init(struct knob_t *ptr, struct knob_parameters_t parameters,
+	const int32_t *positions, uint count, int32_t position);
+
+/*
+ * knob_even:
+ *
+ * count detent positions, evenly spaced between low and high, not on them.
+ */
+void knob_even(int32_t *positions, uint count, int32_t low, int32_t high);
+
+// One filtered position per tick
+void knob_update(struct knob_t *ptr, int32_t position, ms_t now);
+
+/*
+ * knob_reset:
+ *
+ * Take position as where the knob is, without clicking through the jump,
+ * after it was unplugged. Nothing owed. Past a wall it buzzes again after
+ * wall_repeat_ms, like when it is held there.
+ */
+void knob_reset(struct knob_t *ptr, int32_t position, ms_t now);
+
+/*
+ * knob_pop:
+ *
+ * Oldest effect owed, walls first. knob_none if there is none.
+ */
+enum knob_effect knob_pop(struct knob_t *ptr);
+
+// Detents below the position, 0 to count
+uint knob_index(struct knob_t *ptr);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_KNOB_H */
@@ -4,41 +4,22 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
-#include <stdlib.h>
 #include "hardware/gpio.h"
 #include "pico/stdlib.h"
-#include "pico/malloc.h"
 
 #include "config_adv.h"
 #include "led.h"
 
-struct led_t {
-	uint  pin;
-	volatile bool _Atomic state; // true == ON, false == OFF
-	volatile ms_t _Atomic state_since;
-
-	// External
-	volatile bool _Atomic pulse_mode;
-	volatile ms_t _Atomic pulse_half_period;
-};
-#include <stdio.h>
-
-void led_new(struct led_t **ptr, uint pin)
+void led_init(struct led_t *ptr, uint pin)
 {
-	struct led_t *new = malloc(sizeof(struct led_t));
-	if (new == NULL) {
-		// error
-	}
-
-	new->pin = pin;
-	new->state = false;
-	new->state_since = ms_now();
-	new->pulse_mode = false;
-	new->pulse_half_period = 0;
+	ptr->pin = pin;
+	ptr->state = false;
+	ptr->state_since = ms_now();
+	ptr->pulse_mode = false;
+	ptr->pulse_half_period = 0;
 
-	gpio_init(new->pin);
-	gpio_set_dir(new->pin, GPIO_OUT);
-	(*ptr) = new;
+	gpio_init(ptr->pin);
+	gpio_set_dir(ptr->pin, GPIO_OUT);
 }
 
 static inline void led_set_internal(struct led_t *ptr, bool value)
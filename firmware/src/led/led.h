@@ -9,9 +9,23 @@
 
 #include "config_adv.h"
 
-struct led_t;
+/*
+ * struct led_t:
+ *
+ * A GPIO LED, on, off or blinking. Embedded in the owner, set up before
+ * the timer starts, then only touched by the timer callback.
+ */
+struct led_t {
+	uint  pin;
+	bool  state; // true == ON, false == OFF
+	ms_t  state_since;
+
+	// External
+	bool  pulse_mode;
+	ms_t  pulse_half_period;
+};
 
-void led_new(struct led_t **ptr, uint pin);
+void led_init(struct led_t *ptr, uint pin);
 void led_update(struct led_t *ptr);
 void led_set(struct led_t *ptr, bool value);
 void led_set_pulse(struct led_t *ptr, ms_t pulse_half_period);
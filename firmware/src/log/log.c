@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdio.h>
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "counter.h"
+#include "log.h"
+#include "service.h"
+
+struct log_entry_t {
+	uintptr_t format;	// pointer, or token
+	uint32_t us;
+	uint8_t  count;
+	uint32_t args[LOG_ARGS_MAX];
+};
+
+/*
+ * One ring per preemption level. Nothing preempts a context at its own
+ * level, so each ring has a single writer at a time and the service
+ * context is the only reader.
+ */
+enum log_context {
+	log_thread,	// main()
+	log_lowest,	// service, cyw43/btstack
+	log_default,	// timer callback, USB
+	log_other,	// anything else, written with interrupts off
+	log_contexts
+};
+
+static const char *log_context_names[log_contexts] = {"thread", "lowest", "default", "other"};
+
+struct log_ring_t {
+	struct log_entry_t entries[LOG_RING_SIZE];
+	volatile uint32_t _Atomic head;	// written by the context
+	volatile uint32_t _Atomic tail;	// written by the service
+	volatile uint32_t _Atomic dropped;
+	uint32_t reported;
+};
+
+static struct log_ring_t log_rings[log_contexts];
+
+static inline enum log_context log_context_now(void)
+{
+	uint exception = __get_current_exception();
+	if (exception == 0)
+		return log_thread;
+
+	// Faults, SysTick, PendSV
+	if (exception < 16)
+		return log_other;
+
+	// Everything below the default priority runs at the lowest one here
+	uint priority = irq_get_priority(exception - 16);
+	if (priority == PICO_DEFAULT_IRQ_PRIORITY)
+		return log_default;
+	if (priority > PICO_DEFAULT_IRQ_PRIORITY)
+		return log_lowest;
+	return log_other;
+}
+
+static inline void log_push(struct log_ring_t *ring, uintptr_t format, const uint32_t *args, size_t count)
+{
+	uint32_t head = ring->head;
+	uint32_t head_next = (head + 1) % LOG_RING_SIZE;
+	if (head_next == ring->tail) {
+		ring->dropped++;
+		counter_increment(counter_log_dropped);
+		return;
+	}
+
+	struct log_entry_t *entry = &(ring->entries[head]);
+	entry->format = format;
+	entry->us = time_us_32();
+	entry->count = count;
+	for (size_t i = 0; i < count; i++)
+		entry->args[i] = args[i];
+
+	ring->head = head_next; // publish last
+}
+
+void log_write(uintptr_t format, const uint32_t *args, size_t count)
+{
+	enum log_context context = log_context_now();
+	struct log_ring_t *ring = &(log_rings[context]);
+
+	if (context == log_other) {
+		uint32_t irq = save_and_disable_interrupts();
+		log_push(ring, format, args, count);
+		restore_interrupts(irq);
+	} else {
+		log_push(ring, format, args, count);
+	}
+
+	service_request();
+}
+
+#if LOG_TOKENIZED
+
+static const char log_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static inline size_t log_varint(uint8_t *buffer, uint32_t value)
+{
+	size_t length = 0;
+	while (value >= 0x80) {
+		buffer[length++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	buffer[length++] = value;
+	return length;
+}
+
+// Token (little endian), timestamp and arguments as varints, base64
+static inline void log_print(const struct log_entry_t *entry)
+{
+	uint8_t raw[4 + 5 * (1 + LOG_ARGS_MAX)];
+	uint32_t token = entry->format;
+	size_t length = 0;
+
+	raw[length++] = token;
+	raw[length++] = token >> 8;
+	raw[length++] = token >> 16;
+	raw[length++] = token >> 24;
+	length += log_varint(&raw[length], entry->us);
+	for (size_t i = 0; i < entry->count; i++)
+		length += log_varint(&raw[length], entry->args[i]);
+
+	char buffer[2 + (sizeof(raw) + 2) / 3 * 4 + 1];
+	size_t out = 0;
+	buffer[out++] = '$';
+	for (size_t i = 0; i < length; i += 3) {
+		uint32_t group = raw[i] << 16;
+		if (i + 1 < length)
+			group |= raw[i + 1] << 8;
+		if (i + 2 < length)
+			group |= raw[i + 2];
+
+		buffer[out++] = log_base64[(group >> 18) & 0x3f];
+		buffer[out++] = log_base64[(group >> 12) & 0x3f];
+		buffer[out++] = (i + 1 < length) ? log_base64[(group >> 6) & 0x3f] : '=';
+		buffer[out++] = (i + 2 < length) ? log_base64[group & 0x3f] : '=';
+	}
+	buffer[out++] = '\n';
+
+	fwrite(buffer, 1, out, stdout);
+}
+
+#else
+
+static inline void log_print(const struct log_entry_t *entry)
+{
+	char buffer[LOG_LINE_MAX];
+	int length = snprintf(buffer, sizeof(buffer), "[%8lu.%03lu] ",
+		(unsigned long)(entry->us / 1000), (unsigned long)(entry->us % 1000));
+	if (length < 0)
+		return;
+
+	int tmp = snprintf(buffer + length, sizeof(buffer) - length, (const char *)entry->format,
+		entry->args[0], entry->args[1], entry->args[2], entry->args[3]);
+	if (tmp < 0)
+		return;
+
+	length += tmp;
+	if ((size_t)length >= sizeof(buffer))
+		length = sizeof(buffer) - 1;
+
+	fwrite(buffer, 1, length, stdout);
+}
+
+#endif
+
+static void log_service(void)
+{
+	bool printed = false;
+
+	for (size_t i = 0; i < log_contexts; i++) {
+		struct log_ring_t *ring = &(log_rings[i]);
+
+		uint32_t tail = ring->tail;
+		while (tail != ring->head) {
+			struct log_entry_t entry = ring->entries[tail];
+			tail = (tail + 1) % LOG_RING_SIZE;
+			ring->tail = tail;
+
+			log_print(&entry);
+			printed = true;
+		}
+
+		uint32_t dropped = ring->dropped;
+		if (dropped != ring->reported) {
+			printf("[log] %lu dropped in %s context\n", (unsigned long)(dropped - ring->reported), log_context_names[i]);
+			ring->reported = dropped;
+			printed = true;
+		}
+	}
+
+	if (printed)
+		fflush(stdout);
+}
+
+void log_init(void)
+{
+	for (size_t i = 0; i < log_contexts; i++) {
+		log_rings[i].head = 0;
+		log_rings[i].tail = 0;
+		log_rings[i].dropped = 0;
+		log_rings[i].reported = 0;
+	}
+
+	service_init();
+	service_add(log_service);
+}
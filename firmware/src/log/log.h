@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_LOG_H
+#define HAPTIC_BRACELET_FIRMWARE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "config_adv.h"
+#include "log_token.h"
+
+#define LOG_ARGS_MAX 4
+
+/*
+ * LOG:
+ *
+ * printf() for any context, the timer callback included. Only the format
+ * pointer, a timestamp and the arguments are kept, in a ring for the
+ * calling context. Formatting and output happen later, in the service
+ * context.
+ *
+ * Up to LOG_ARGS_MAX arguments, all 32 bit integers (%d %u %x %ld %lu
+ * %c). The format must be a literal. Strings and 64 bit values can't be
+ * deferred, cast or use PRINTF outside of interrupts.
+ *
+ * With LOG_TOKENIZED only a 32 bit token of the format is kept, and the
+ * output is binary: '$', then base64 of the token, the timestamp and the
+ * arguments as varints, then '\n'. host/tools/haptic_detok.cpp turns it
+ * back into text, with a database built from the firmware sources.
+ */
+#define LOG_ARGS(...)  ((const uint32_t []){0, ##__VA_ARGS__})
+#define LOG_COUNT(...) (sizeof(LOG_ARGS(__VA_ARGS__)) / sizeof(uint32_t) - 1)
+
+#if LOG_TOKENIZED
+#define LOG_FORMAT(format) ((uintptr_t)LOG_TOKEN(format))
+#else
+#define LOG_FORMAT(format) ((uintptr_t)(format))
+#endif
+
+#define LOG(format, ...) do { \
+	_Static_assert(LOG_COUNT(__VA_ARGS__) <= LOG_ARGS_MAX, "LOG takes up to 4 arguments"); \
+	log_write(LOG_FORMAT(format), LOG_ARGS(__VA_ARGS__) + 1, LOG_COUNT(__VA_ARGS__)); \
+} while (0)
+
+void log_init(void);
+
+/*
+ * log_write:
+ *
+ * Use LOG(). format is the format pointer, or its token. Dropped, and
+ * counted, if the ring is full.
+ */
+void log_write(uintptr_t format, const uint32_t *args, size_t count);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_LOG_H */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_LOG_TOKEN_H
+#define HAPTIC_BRACELET_FIRMWARE_LOG_TOKEN_H
+
+#include <stdint.h>
+
+/*
+ * LOG_TOKEN:
+ *
+ * 32 bit token of a string literal, folded by the compiler so the string
+ * itself never reaches flash. The length plus each character times
+ * successive powers of 65599, over the first LOG_TOKEN_LENGTH characters.
+ * host/tools/haptic_detok.cpp computes the same hash for its database;
+ * keep them in sync.
+ */
+#define LOG_TOKEN_K      65599u
+#define LOG_TOKEN_LENGTH 64
+
+#define LOG_TOKEN_CHAR(s, i) \
+	((i) < sizeof(s) - 1 ? (uint32_t)(uint8_t)(s)[(i) < sizeof(s) - 1 ? (i) : 0] : 0u)
+
+#define LOG_TOKEN(s) ((uint32_t)(sizeof(s) - 1) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 0) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 1) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 2) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 3) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 4) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 5) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 6) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 7) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 8) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 9) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 10) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 11) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 12) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 13) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 14) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 15) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 16) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 17) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 18) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 19) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 20) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 21) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 22) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 23) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 24) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 25) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 26) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 27) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 28) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 29) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 30) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 31) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 32) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 33) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 34) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 35) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 36) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 37) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 38) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 39) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 40) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 41) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 42) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 43) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 44) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 45) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 46) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 47) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 48) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 49) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 50) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 51) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 52) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 53) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 54) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 55) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 56) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 57) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 58) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 59) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 60) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 61) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 62) + \
+	LOG_TOKEN_K * (LOG_TOKEN_CHAR(s, 63) + \
+	0u)))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_LOG_TOKEN_H */
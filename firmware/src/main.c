@@ -21,101 +21,145 @@
 
 // Internal Libraries
 #include "analog.h"
+#include "command.h"
+#include "counter.h"
 #include "digital.h"
+#include "eventlog.h"
 #include "btstack_main.h"
+#include "gesture.h"
+#include "intensity.h"
+#include "knob.h"
 #include "led.h"
+#include "log.h"
 #include "motor.h"
+#include "sampler.h"
+#include "service.h"
+#include "tick.h"
+#include "timing.h"
+#include "trace.h"
+#include "usb.h"
 
-extern void bluetooth_disconnect();
-
+/*
+ * bracelet_t:
+ *
+ * Everything the tick touches, embedded so the devices sit together in one
+ * block instead of in separate pools. Only the fields shared with another
+ * context (button edge rings, motor claim, Bluetooth state) are atomic.
+ */
 struct bracelet_t {
 	// On board
-	struct led_t     *status_led;
-	struct digital_t *button_pair;
+	struct led_t     status_led;
+	struct digital_t button_pair;
+	struct gesture_t gesture_pair;
 	struct bt_data_t *bt_data;
+	struct command_link_t *usb_commands;
 
 	// Motor
-	struct motor_t   *motor;
+	struct motor_t   motor;
 
 	// Aux
-	struct digital_t *aux_connected;
-	struct digital_t *button_aux;
-	struct analog_t  *radial_aux;
+	struct digital_t aux_connected;
+	struct digital_t button_aux;
+	struct gesture_t gesture_aux;
+	struct analog_t  radial_aux;
+#if KNOB_ENABLED
+	struct knob_t    knob_aux;
+#endif
+	struct intensity_t intensity_aux;
 };
 
-static inline void print_timestamp()
-{
-	PRINTF("[%8ju] ", (uintmax_t)ms_now());
-}
-
 static inline void bracelet_init(struct bracelet_t *ptr, struct motor_parameters_t motor_parameters)
 {
-	ptr->status_led    = NULL;
-	ptr->button_pair   = NULL;
-
-	ptr->motor         = NULL;
-
-	ptr->aux_connected = NULL;
-	ptr->button_aux    = NULL;
+	command_link_new(&(ptr->bt_data->commands), bluetooth_reply, eventlog_bluetooth);
+	command_link_new(&(ptr->usb_commands), usb_reply, eventlog_usb);
 
 	stdio_init_all();
+	usb_init(ptr->usb_commands);
+	log_init();
+	trace_init();
+	eventlog_init();
 	adc_init();
+	sampler_init();
 	sleep_ms(3000);
 	fflush(stdout);
 
-	print_timestamp();
-	PRINTF("Init led\n");
-	led_new(&(ptr->status_led), PIN_LED);
-	led_set(ptr->status_led, true);
-
-	print_timestamp();
-	PRINTF("Init pair button\n");
-	digital_new(&(ptr->button_pair), PIN_PAIR,        low_is_false);
-
-	print_timestamp();
-	PRINTF("Init motor\n");
-	motor_new(&(ptr->motor), PIN_MOTOR_A1, PIN_MOTOR_A2, PIN_MOTOR_FAULT);
-	motor_set_parameters(ptr->motor, motor_parameters);
-
-	print_timestamp();
-	PRINTF("Init aux\n");
-	digital_new(&(ptr->aux_connected), PIN_AUX_DETECT,  low_is_false);
-	digital_new(&(ptr->button_aux),    PIN_AUX_DIGITAL, low_is_false);
-	analog_new( &(ptr->radial_aux),    PIN_AUX_ANALOG,  ADC_CHANNEL_AUX_ANALOG);
-
-	//print_timestamp();
-	//PRINTF("Init pair bluetooth\n");
+	LOG("Init led\n");
+	led_init(&(ptr->status_led), PIN_LED);
+	led_set(&(ptr->status_led), true);
+
+	LOG("Init pair button\n");
+	digital_init(&(ptr->button_pair), PIN_PAIR,        low_is_false, DIGITAL_DEBOUNCE_PAIR);
+	gesture_init(&(ptr->gesture_pair), &(ptr->button_pair));
+
+	LOG("Init motor\n");
+	motor_init(&(ptr->motor), PIN_MOTOR_A1, PIN_MOTOR_A2, PIN_MOTOR_FAULT);
+	motor_set_parameters(&(ptr->motor), motor_parameters);
+
+	LOG("Init aux\n");
+	digital_init(&(ptr->aux_connected), PIN_AUX_DETECT,  low_is_false, DIGITAL_DEBOUNCE_AUX_DETECT);
+	digital_init(&(ptr->button_aux),    PIN_AUX_DIGITAL, low_is_false, DIGITAL_DEBOUNCE_AUX_BUTTON);
+	gesture_init(&(ptr->gesture_aux),   &(ptr->button_aux));
+	analog_init( &(ptr->radial_aux),    PIN_AUX_ANALOG,  ADC_CHANNEL_AUX_ANALOG);
+	struct intensity_parameters_t intensity_parameters = {
+		.speed_min    = AUX_SPEED_MIN,
+		.speed_max    = AUX_SPEED_MAX,
+		.ms_min       = AUX_PULSE_MS_MIN,
+		.ms_max       = AUX_PULSE_MS_MAX,
+		.pwm_min      = AUX_PWM_MIN,
+		.pwm_max      = AUX_PWM_MAX,
+		.lead_ms      = AUX_LEAD_MS,
+		.duty_percent = AUX_DUTY_PERCENT,
+		.window_ms    = AUX_DUTY_WINDOW_MS
+	};
+	intensity_init(&(ptr->intensity_aux), intensity_parameters);
+#if KNOB_ENABLED
+	struct knob_parameters_t knob_parameters = {
+		.hysteresis     = KNOB_HYSTERESIS,
+		.wall_low       = KNOB_WALL_LOW,
+		.wall_high      = KNOB_WALL_HIGH,
+		.wall_repeat_ms = KNOB_WALL_REPEAT_MS
+	};
+#ifdef KNOB_DETENT_POSITIONS
+	const int32_t detents[] = KNOB_DETENT_POSITIONS;
+#else
+	int32_t detents[KNOB_DETENTS];
+	knob_even(detents, KNOB_DETENTS, KNOB_WALL_LOW, KNOB_WALL_HIGH);
+#endif
+	knob_init(&(ptr->knob_aux), knob_parameters, detents, sizeof(detents) / sizeof(detents[0]),
+		analog_now(&(ptr->radial_aux)));
+#endif
+
+	//LOG("Init pair bluetooth\n");
 	cyw43_arch_init();
 
-	print_timestamp();
-	PRINTF("Init done\n");
+	LOG("Init done\n");
 }
 
 static inline void calibrate__brake_ms_max(struct bracelet_t *bracelet)
 {
-	PRINTF("Calibration #2: brake_ms_max\n");
+	LOG("Calibration #2: brake_ms_max\n");
 	struct motor_parameters_t parameters = {
 		.reverse_denominator = 1,
 		.reverse_ms_max = 0,
 		.brake_denominator = 1,
 		.brake_ms_max = 150
 	};
-	motor_set_parameters(bracelet->motor, parameters);
+	motor_set_parameters(&(bracelet->motor), parameters);
 
-	while (!digital_trap(bracelet->button_pair));
+	while (!digital_trap(&(bracelet->button_pair)));
 
 	int pulses = 0;
 	while (parameters.brake_ms_max > 10) {
 		if (pulses == 0) {
 			sleep_ms(1000);
 			parameters.brake_ms_max -= 10;
-			motor_set_parameters(bracelet->motor, parameters);
-			PRINTF("brake ms %lu\n", parameters.brake_ms_max);
+			motor_set_parameters(&(bracelet->motor), parameters);
+			LOG("brake ms %lu\n", parameters.brake_ms_max);
 			pulses = 5;
 		}
 
-		if (motor_get_state(bracelet->motor) == motor_asleep) {
-			motor_pulse(bracelet->motor, 1000);
+		if (motor_get_state(&(bracelet->motor)) == motor_asleep) {
+			motor_pulse(&(bracelet->motor), 1000);
 			pulses--;
 		}
 	}
@@ -124,29 +168,29 @@ static inline void calibrate__brake_ms_max(struct bracelet_t *bracelet)
 
 static inline void calibrate__reverse_ms_max(struct bracelet_t *bracelet)
 {
-	PRINTF("Calibration #3: reverse_ms_max\n");
+	LOG("Calibration #3: reverse_ms_max\n");
 	struct motor_parameters_t parameters = {
 		.reverse_denominator = 1,
 		.reverse_ms_max = 20,
 		.brake_denominator = 1,
 		.brake_ms_max = 150
 	};
-	motor_set_parameters(bracelet->motor, parameters);
+	motor_set_parameters(&(bracelet->motor), parameters);
 
-	while (!digital_trap(bracelet->button_pair));
+	while (!digital_trap(&(bracelet->button_pair)));
 
 	int pulses = 0;
 	while (parameters.reverse_ms_max > 2) {
 		if (pulses == 0) {
 			sleep_ms(1000);
 			parameters.reverse_ms_max -= 2;
-			motor_set_parameters(bracelet->motor, parameters);
-			PRINTF("reverse ms %lu\n", parameters.reverse_ms_max);
+			motor_set_parameters(&(bracelet->motor), parameters);
+			LOG("reverse ms %lu\n", parameters.reverse_ms_max);
 			pulses = 5;
 		}
 
-		if (motor_get_state(bracelet->motor) == motor_asleep) {
-			motor_pulse(bracelet->motor, 1000);
+		if (motor_get_state(&(bracelet->motor)) == motor_asleep) {
+			motor_pulse(&(bracelet->motor), 1000);
 			pulses--;
 		}
 	}
@@ -155,18 +199,18 @@ static inline void calibrate__reverse_ms_max(struct bracelet_t *bracelet)
 
 static inline void calibrate_denominator(struct bracelet_t *bracelet, struct motor_parameters_t parameters)
 {
-	PRINTF("Calibration #4: denominator\n");
-	while (!digital_trap(bracelet->button_pair));
+	LOG("Calibration #4: denominator\n");
+	while (!digital_trap(&(bracelet->button_pair)));
 
-	PRINTF("brake\trev\tms\t#");
+	LOG("brake\trev\tms\t#\n");
 	for (parameters.brake_denominator = 6; parameters.brake_denominator > 2; parameters.brake_denominator--) {
 		for (parameters.reverse_denominator = 7; parameters.reverse_denominator > 3; parameters.reverse_denominator--) {
 			for (ms_t duration = 100; duration > 10; duration -= 10) {
 				for (int pulses = 5; pulses > 0; pulses--) {
-					motor_set_parameters(bracelet->motor, parameters);
-					PRINTF("%lu\t%lu\t%lu\t%d\n", parameters.brake_denominator, parameters.reverse_denominator, duration, pulses);
-					motor_pulse(bracelet->motor, duration);
-					while (motor_get_state(bracelet->motor) != motor_asleep);
+					motor_set_parameters(&(bracelet->motor), parameters);
+					LOG("%lu\t%lu\t%lu\t%d\n", parameters.brake_denominator, parameters.reverse_denominator, duration, pulses);
+					motor_pulse(&(bracelet->motor), duration);
+					while (motor_get_state(&(bracelet->motor)) != motor_asleep);
 				}
 				sleep_ms(1000);
 			}
@@ -178,13 +222,16 @@ static inline void calibrate_denominator(struct bracelet_t *bracelet, struct mot
 static inline void test_pulse(struct bracelet_t *bracelet)
 {
 	int pulses = 0;
+	// The pair button's gestures take its transitions, watch the press time
+	us_t pressed = digital_pressed_at(&(bracelet->button_pair));
 	while (true) {
-		if (digital_went_true(bracelet->button_pair)) {
-			PRINTF("+20 pulses\n");
+		if (digital_pressed_at(&(bracelet->button_pair)) != pressed) {
+			pressed = digital_pressed_at(&(bracelet->button_pair));
+			LOG("+20 pulses\n");
 			pulses = 20;
 		}
-		if (pulses > 0 && motor_get_state(bracelet->motor) == motor_asleep) {
-			motor_pulse(bracelet->motor, 30);
+		if (pulses > 0 && motor_get_state(&(bracelet->motor)) == motor_asleep) {
+			motor_pulse(&(bracelet->motor), 30);
 			pulses--;
 		}
 	}
@@ -201,11 +248,11 @@ static inline void test_pulse(struct bracelet_t *bracelet)
 
 static inline void test_battery(struct bracelet_t *bracelet)
 {
-	while (!digital_trap(bracelet->button_pair));
+	while (!digital_trap(&(bracelet->button_pair)));
 
 	int pulses = 0;
 	while (true) {
-		if (motor_get_state(bracelet->motor) != motor_asleep)
+		if (motor_get_state(&(bracelet->motor)) != motor_asleep)
 			continue;
 		
 		if (pulses == 0) {
@@ -214,7 +261,7 @@ static inline void test_battery(struct bracelet_t *bracelet)
 		}
 
 		if (pulses > 0) {
-			motor_pulse(bracelet->motor, 30);
+			motor_pulse(&(bracelet->motor), 30);
 			pulses--;
 		}
 	}
@@ -223,18 +270,12 @@ static inline void test_battery(struct bracelet_t *bracelet)
 
 struct bt_data_t bluetooth_data = {
 	.connected = false,
-	.command1  = 0,
-	.command2  = 0
+	.commands  = NULL
 };
 
 struct bracelet_t bracelet = {
-	.status_led    = NULL,
-	.button_pair   = NULL,
 	.bt_data       = &bluetooth_data,
-	.motor         = NULL,
-	.aux_connected = NULL,
-	.button_aux    = NULL,
-	.radial_aux    = NULL
+	.usb_commands  = NULL
 };
 
 struct led_t     *status_led;
@@ -248,102 +289,217 @@ struct digital_t *aux_connected;
 struct digital_t *button_aux;
 struct analog_t  *radial_aux;
 
+// Knob pulses scale with the turning speed, none if rate limited
+static inline void bracelet_aux_pulse(struct bracelet_t *ptr, ms_t *ms, pwm_t *pwm)
+{
+	if (!intensity_pulse(&(ptr->intensity_aux), analog_velocity(&(ptr->radial_aux)),
+			analog_acceleration(&(ptr->radial_aux)), ms_now(), ms, pwm))
+		*ms = 0;
+}
+
 static inline void bracelet_pulse(struct bracelet_t *ptr)
 {
 	// Don't consume
-	if (motor_get_state(ptr->motor) != motor_asleep)
+	if (motor_get_state(&(ptr->motor)) != motor_asleep)
 		return;
 
 	ms_t ms = 0;
-
-	if (digital_went_true(ptr->button_aux)) {
-		ms = 20;
-		goto out;
+	pwm_t pwm = 0;	// 0 for the motor's own level
+	uint8_t source = eventlog_device;
+
+	// Press and release pulse right away, the rest is logged
+	struct gesture_event_t gesture;
+	while (gesture_pop(&(ptr->gesture_aux), &gesture)) {
+		switch (gesture.type) {
+			case gesture_down:
+				eventlog_add(eventlog_aux_down, eventlog_device, 0);
+				ms = 20;
+				goto out;
+
+			case gesture_up:
+				eventlog_add(eventlog_aux_up, eventlog_device, 0);
+				ms = 10;
+				goto out;
+
+			case gesture_repeat:
+				eventlog_add(eventlog_aux_gesture, eventlog_device, gesture.type);
+				ms = 10;
+				goto out;
+
+			default:
+				eventlog_add(eventlog_aux_gesture, eventlog_device, gesture.type);
+				break;
+		}
 	}
 
-	if (digital_went_false(ptr->button_aux)) {
-		ms = 10;
+#if KNOB_ENABLED
+	{
+		enum knob_effect effect = knob_pop(&(ptr->knob_aux));
+		if (effect == knob_click) {
+			eventlog_add(eventlog_aux_click, eventlog_device, knob_index(&(ptr->knob_aux)));
+			bracelet_aux_pulse(ptr, &ms, &pwm);
+			goto out;
+		}
+		if (effect == knob_wall) {
+			eventlog_add(eventlog_aux_wall, eventlog_device, analog_now(&(ptr->radial_aux)));
+			ms = KNOB_WALL_MS;
+			goto out;
+		}
+	}
+#else
+	if (analog_moved(&(ptr->radial_aux), NULL)) {
+		eventlog_add(eventlog_aux_move, eventlog_device, analog_now(&(ptr->radial_aux)));
+		bracelet_aux_pulse(ptr, &ms, &pwm);
 		goto out;
 	}
-
-	if (analog_active(ptr->radial_aux, 5)) {
-		ms = 15;
+#endif
+	if (analog_active2(&(ptr->radial_aux), 20)) {
+		eventlog_add(eventlog_aux_move, eventlog_device, analog_now(&(ptr->radial_aux)));
+		bracelet_aux_pulse(ptr, &ms, &pwm);
 		goto out;
 	}
-	if (analog_active2(ptr->radial_aux, 20)) {
-		ms = 15;
+
+	if (atomic_load_explicit(&(ptr->bt_data->connected), memory_order_relaxed) && command_pop(ptr->bt_data->commands, &ms)) {
+		LOG("run %lu\n", ms);
+		source = eventlog_bluetooth;
 		goto out;
 	}
 
-	if (ptr->bt_data->connected) {
-		if (ptr->bt_data->command1 != 0) {
-			ms = ptr->bt_data->command1;
-			ptr->bt_data->command1 = 0;
-			PRINTF("run %ld\n", ms);
-		}
-		else if (ptr->bt_data->command2 != 0) {
-			ms = ptr->bt_data->command2;
-			ptr->bt_data->command2 = 0;
-			PRINTF("run %ld\n", ms);
-		}
+	if (command_pop(ptr->usb_commands, &ms)) {
+		LOG("run %lu\n", ms);
+		source = eventlog_usb;
 	}
 out:
-	if (ms > 0)
-		motor_pulse(ptr->motor, ms);
+	if (ms > 0) {
+		eventlog_add(eventlog_pulse, source, ms);
+		counter_increment(counter_pulses_device + source);
+		if (pwm > 0)
+			motor_pulse_pwm(&(ptr->motor), ms, pwm);
+		else
+			motor_pulse(&(ptr->motor), ms);
+	}
 }
 
-bool timer_callback(__unused repeating_timer_t *rt)
+static inline void bracelet_pair(struct bracelet_t *ptr)
 {
-	#if MEASURE_CALLBACK_TIME
-	us_t start = us_now();
-	#endif
-
-	// On Board
-	if (!bracelet.bt_data->connected) {
-		led_set_pulse(bracelet.status_led, 1000);
-	} else {
-		led_set(bracelet.status_led, true);
+	struct gesture_event_t gesture;
+	while (gesture_pop(&(ptr->gesture_pair), &gesture)) {
+		if (gesture.type == gesture_double)
+			bluetooth_disconnect(false);
+
+		// Once, on the repeat that gets there
+		if (gesture.type == gesture_repeat && gesture.held >= PAIR_FORGET_MS &&
+		    gesture.held < PAIR_FORGET_MS + GESTURE_REPEAT_MS)
+			bluetooth_disconnect(true);
 	}
+}
 
-	led_update(bracelet.status_led);
-	digital_update(bracelet.button_pair);
+// After the debounced transitions, from the tick or an edge
+static inline void bracelet_inputs(struct bracelet_t *ptr)
+{
+	// Floating while unplugged
+	if (!digital_now(&(ptr->aux_connected)))
+		digital_discard(&(ptr->button_aux));
 
-	// Motor
-	motor_update(bracelet.motor);
+	us_t now = us_now();
+	gesture_update(&(ptr->gesture_pair), now);
+	gesture_update(&(ptr->gesture_aux), now);
 
-	// Aux
-	digital_update(bracelet.aux_connected);
+	bracelet_pair(ptr);
+}
 
-	if (digital_now(bracelet.aux_connected)) {
-		digital_update(bracelet.button_aux);
-		analog_update(bracelet.radial_aux);
-	}
+static void task_inputs(void)
+{
+	// Every pin at once, the motor fault too
+	digital_bank_update();
+	bracelet_inputs(&bracelet);
+}
 
+static void task_motor(void)
+{
+	motor_update(&(bracelet.motor));
+}
+
+static void task_pulse(void)
+{
 	bracelet_pulse(&bracelet);
-	/*
-	 * Pi pico CYW43 reset bug?
-	 * I'm disabling this code since it does nothing.
-	 */
-
-	/*
-	if (digital_held_true(bracelet.button_pair, 3000)) {
-		// I have no idea if this is correct.
-		PRINTF("Attempting reset\n");
-		bluetooth_disconnect();
-		hci_power_control(HCI_POWER_OFF);
-		for (int i = 0; i < le_device_db_max_count(); i++)
-			le_device_db_remove(i);
-		sleep_ms(3000);
-		hci_power_control(HCI_POWER_ON);
+}
 
+static void task_aux(void)
+{
+	if (!digital_now(&(bracelet.aux_connected)))
+		return;
+
+	// Just plugged in, the reading jumps from wherever it floated
+	if (digital_went_true(&(bracelet.aux_connected))) {
+		analog_reset(&(bracelet.radial_aux));
+#if KNOB_ENABLED
+		knob_reset(&(bracelet.knob_aux), analog_now(&(bracelet.radial_aux)), ms_now());
+#endif
+		return;
+	}
+
+	analog_update(&(bracelet.radial_aux));
+#if KNOB_ENABLED
+	knob_update(&(bracelet.knob_aux), analog_now(&(bracelet.radial_aux)), ms_now());
+#endif
+}
+
+static void task_led(void)
+{
+	if (!atomic_load_explicit(&(bracelet.bt_data->connected), memory_order_relaxed)) {
+		led_set_pulse(&(bracelet.status_led), 1000);
+	} else {
+		led_set(&(bracelet.status_led), true);
 	}
-	*/
 
-	#if MEASURE_CALLBACK_TIME
-	us_t time_difference = us_now() - start;
-	if (time_difference != 0)
-		PRINTF("%ju\n", (uintmax_t)time_difference);
-	#endif
+	led_update(&(bracelet.status_led));
+}
+
+/*
+ * Timer callback tasks, in order. Critical first, so the motor phases and
+ * command dispatch keep their timing when a tick runs long. Aux before
+ * pulse, a click or movement is pulsed the tick it is seen, and critical:
+ * the tracker and the movement detector want one reading per tick. Only
+ * the LED is put off, a tick late at worst, or TICK_SHED_MAX under
+ * constant overload.
+ */
+static struct tick_task_t tasks[] = {
+	{ task_inputs, timing_inputs, tick_critical,  20, 0 },
+	{ task_motor,  timing_motor,  tick_critical,  20, 0 },
+	{ task_aux,    timing_aux,    tick_critical,  20, 0 },
+	{ task_pulse,  timing_pulse,  tick_critical,  50, 0 },
+	{ task_led,    timing_led,    tick_sheddable, 10, 0 }
+};
+
+#if DIGITAL_EDGE_IRQ
+/*
+ * From the GPIO interrupt, at the timer callback's priority: an aux press
+ * (LOCKOUT, switches on its first edge) is pulsed now instead of at the
+ * next tick, up to a tick sooner. The motor is left to the tick.
+ */
+static void edge_callback(void)
+{
+	trace_begin(trace_tick, 1);
+	digital_bank_edges();
+	bracelet_inputs(&bracelet);
+	bracelet_pulse(&bracelet);
+	trace_end(trace_tick, 1);
+}
+#endif
+
+bool timer_callback(__unused repeating_timer_t *rt)
+{
+	timing_start();
+	trace_begin(trace_tick, 0);
+
+	tick_run(tasks, sizeof(tasks) / sizeof(tasks[0]));
+
+	trace_end(trace_tick, 0);
+	timing_end();
+
+	// USB and other deferred work
+	service_request();
 
 	return true;
 }
@@ -360,9 +516,13 @@ int main()
 
 	// Motor tuned values
 	bracelet_init(&bracelet, motor_parameters);
+#if DIGITAL_EDGE_IRQ
+	digital_on_edge(edge_callback);
+#endif
 
 	repeating_timer_t timer;
-	int rc = add_repeating_timer_us(1000, timer_callback, NULL, &timer);
+	// Negative, the period is from start to start
+	int rc = add_repeating_timer_us(-TICK_PERIOD_US, timer_callback, NULL, &timer);
 	if (!rc)
 		return 1;
 	
@@ -4,36 +4,25 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
 #include "pico/stdlib.h"
-#include "pico/malloc.h"
 
 #include "config_adv.h"
 
+#include "counter.h"
 #include "digital.h"
 #include "motor.h"
-
-struct motor_t {
-	uint pwm_slice;
-	struct digital_t *fault;
-	struct motor_parameters_t parameters;
-
-	ms_t reverse_ms;		// ms to run reverse
-	ms_t brake_ms;			// ms to brake
-
-	volatile _Atomic int state;		// Current state
-	volatile _Atomic ms_t time_next;	// Timestamp to next state
-	volatile _Atomic ms_t last_activation;	// Last time update function was called
-};
+#include "trace.h"
 
 static inline void motor_pwm(
 	struct motor_t *ptr,
 	pwm_t pico_pwm_channel_A,
 	pwm_t pico_pwm_channel_B)
 {
-	if (digital_trap(ptr->fault)) {
+	if (digital_trap(&(ptr->fault))) {
 		pico_pwm_channel_A = 0;
 		pico_pwm_channel_B = 0;
 	}
@@ -42,51 +31,38 @@ static inline void motor_pwm(
 	pwm_set_chan_level(ptr->pwm_slice, PWM_CHAN_B, pico_pwm_channel_B);
 }
 
-void motor_new(
-	struct motor_t **ptr,
+void motor_init(
+	struct motor_t *ptr,
 	uint pin_motorA_1,
 	uint pin_motorA_2,
 	uint pin_fault)
 {
-	struct motor_t *new = malloc(sizeof(struct motor_t));
-	if (new == NULL) {
-		// error
-	}
-
 	// Initialize pwm_slice
 	gpio_set_function(pin_motorA_1, GPIO_FUNC_PWM);
 	gpio_set_function(pin_motorA_2, GPIO_FUNC_PWM);
-	new->pwm_slice = pwm_gpio_to_slice_num(pin_motorA_1);
-	if (new->pwm_slice != pwm_gpio_to_slice_num(pin_motorA_2)) {
+	ptr->pwm_slice = pwm_gpio_to_slice_num(pin_motorA_1);
+	if (ptr->pwm_slice != pwm_gpio_to_slice_num(pin_motorA_2)) {
 		// error
 	}
 
-	pwm_set_wrap(new->pwm_slice, 255);
-	pwm_set_enabled(new->pwm_slice, true);
+	pwm_set_wrap(ptr->pwm_slice, 255);
+	pwm_set_enabled(ptr->pwm_slice, true);
 
 	// Initialize fault pin (it's inverted, so low_is_true)
-	new->fault = NULL;
-	digital_new(&(new->fault), pin_fault, low_is_true);
+	digital_init(&(ptr->fault), pin_fault, low_is_true, DIGITAL_DEBOUNCE_NONE);
 
-	motor_pwm(new, 0, 0);
-	new->state = motor_asleep;
+	motor_pwm(ptr, 0, 0);
 
-	new->time_next  = ms_now();
-	new->last_activation = 0;
-	new->reverse_ms = 0;
-	new->brake_ms   = 0;
-
-	*ptr = new;
-}
-
-void motor_free(struct motor_t *ptr)
-{
-	free(ptr);
+	ptr->time_next  = ms_now();
+	ptr->last_activation = 0;
+	ptr->reverse_ms = 0;
+	ptr->brake_ms   = 0;
+	atomic_init(&(ptr->state), motor_asleep);
 }
 
 int  motor_get_state(struct motor_t *ptr)
 {
-	return (ptr->state);
+	return atomic_load_explicit(&(ptr->state), memory_order_acquire);
 }
 
 void motor_set_parameters(struct motor_t *ptr, struct motor_parameters_t parameters)
@@ -96,13 +72,15 @@ void motor_set_parameters(struct motor_t *ptr, struct motor_parameters_t paramet
 
 void motor_update(struct motor_t *ptr)
 {
-	digital_update(ptr->fault);
-	if (digital_went_true(ptr->fault)) {
+	// The fault pin is updated with the bank, before
+	if (digital_went_true(&(ptr->fault))) {
 		//error
+		counter_increment(counter_motor_faults);
 	}
 
 	ms_t now = ms_now();
-	if (ptr->state == motor_asleep)
+	int state = atomic_load_explicit(&(ptr->state), memory_order_acquire);
+	if (state == motor_asleep || state == motor_claimed)
 		return;
 	if (now < ptr->time_next)
 		return;
@@ -110,38 +88,47 @@ void motor_update(struct motor_t *ptr)
 	pwm_t channel_A = 0;
 	pwm_t channel_B = 0;
 
-	switch (ptr->state) {
+	switch (state) {
 		case motor_forward:
 			channel_A = 0;
 			channel_B = 255;
 			ptr->time_next = now + ptr->reverse_ms;
-			ptr->state++;
+			state++;
 			break;
 
 		case motor_reverse:
 			channel_A = 255;
 			channel_B = 255;
 			ptr->time_next = now + ptr->brake_ms;
-			ptr->state++;
+			state++;
 			break;
 
 		case motor_brake:
 			ptr->last_activation = now;
-			ptr->state = motor_asleep;
+			state = motor_asleep;
 			break;
 
 		default:
 			break;
 	}
+	trace_instant(trace_motor, state);
 	motor_pwm(ptr, channel_A, channel_B);
+	atomic_store_explicit(&(ptr->state), state, memory_order_release);
 }
 
 void motor_pulse(struct motor_t *ptr, ms_t ms)
 {
-	if (ptr->state != motor_asleep)
+	motor_pulse_pwm(ptr, ms, ptr->parameters.pwm);
+}
+
+void motor_pulse_pwm(struct motor_t *ptr, ms_t ms, pwm_t pwm)
+{
+	// The main thread and the timer callback both start pulses, one wins
+	int asleep = motor_asleep;
+	if (!atomic_compare_exchange_strong_explicit(&(ptr->state), &asleep, motor_claimed,
+			memory_order_acquire, memory_order_relaxed))
 		return;
 
-	ptr->state++;
 	// Dampen activation if multiple happen consecutively.
 	ms_t now = ms_now();
 	if (ms > 10 && now - ptr->last_activation < 200)
@@ -159,5 +146,7 @@ void motor_pulse(struct motor_t *ptr, ms_t ms)
 
 	ptr->time_next = now + ms;
 
-	motor_pwm(ptr, ptr->parameters.pwm, 0);
+	trace_instant(trace_motor, motor_forward);
+	motor_pwm(ptr, pwm, 0);
+	atomic_store_explicit(&(ptr->state), motor_forward, memory_order_release);
 }
\ No newline at end of file
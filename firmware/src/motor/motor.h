@@ -7,10 +7,14 @@
 #ifndef HAPTIC_BRACELET_FIRMWARE_MOTOR_H
 #define HAPTIC_BRACELET_FIRMWARE_MOTOR_H
 
+#include <stdatomic.h>
+
 #include "config_adv.h"
-enum motor_states {motor_asleep, motor_forward, motor_reverse, motor_brake};
+#include "digital.h"
+
+// motor_claimed: a pulse is being set up, busy like the others
+enum motor_states {motor_asleep, motor_forward, motor_reverse, motor_brake, motor_claimed};
 
-struct motor_t;
 struct motor_parameters_t {
 	uint pwm;
 	ms_t reverse_denominator;
@@ -19,17 +23,46 @@ struct motor_parameters_t {
 	ms_t brake_ms_max;
 };
 
-void motor_new(
-	struct motor_t **ptr,
+/*
+ * struct motor_t:
+ *
+ * The vibration motor on an H bridge: a pulse runs forward, then reverse
+ * and brake to stop it short. Embedded in the owner, phased by the timer
+ * callback; pulses start from there or the main thread.
+ */
+struct motor_t {
+	uint pwm_slice;
+	struct digital_t fault;
+	struct motor_parameters_t parameters;
+
+	// Owned by whoever moves state: motor_pulse_pwm() from motor_asleep
+	// through motor_claimed, the timer callback otherwise
+	ms_t reverse_ms;		// ms to run reverse
+	ms_t brake_ms;			// ms to brake
+	ms_t time_next;			// Timestamp to next state
+	ms_t last_activation;		// Last time update function was called
+
+	// Stored with release after the above, loaded with acquire before them
+	_Atomic int state;		// Current state
+};
+
+void motor_init(
+	struct motor_t *ptr,
 	uint pin_motorA_1,
 	uint pin_motorA_2,
 	uint pin_fault);
-
-void motor_free(struct motor_t *ptr);
 int  motor_get_state(struct motor_t *ptr);
 void motor_set_parameters(struct motor_t *ptr, struct motor_parameters_t parameters);
 
 void motor_update(struct motor_t *ptr);
 void motor_pulse(struct motor_t *ptr, ms_t ms);
 
+/*
+ * motor_pulse_pwm:
+ *
+ * motor_pulse() at another drive level than parameters.pwm, up to 255.
+ * Reverse and brake stay at full strength.
+ */
+void motor_pulse_pwm(struct motor_t *ptr, ms_t ms, pwm_t pwm);
+
 #endif /* HAPTIC_BRACELET_FIRMWARE_MOTOR_H */
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdlib.h>
+
+#include "config.h"
+#include "movement.h"
+
+// Readings are scaled up by this many bits, for the filters
+#define MOVEMENT_SCALE 4
+
+enum movement_side {movement_up, movement_down};
+
+static inline void movement_restart(struct movement_t *ptr, int side)
+{
+	ptr->sum[side]    = 0;
+	ptr->origin[side] = ptr->last;
+	ptr->age[side]    = 0;
+}
+
+void movement_init(struct movement_t *ptr, int32_t value)
+{
+	ptr->last  = value << MOVEMENT_SCALE;
+	ptr->slope = 0;
+	ptr->slope_sum = 0;
+	ptr->noise = MOVEMENT_NOISE_MIN;
+	ptr->noise_sum = MOVEMENT_NOISE_MIN << MOVEMENT_NOISE_SHIFT;
+	ptr->settle = 1 << MOVEMENT_NOISE_SHIFT;
+	ptr->direction = 0;
+	ptr->quiet = 0;
+
+	movement_restart(ptr, movement_up);
+	movement_restart(ptr, movement_down);
+}
+
+/*
+ * Averaged with the fraction kept, and rounded: a plain shift of the step
+ * drops any rise smaller than 2^MOVEMENT_NOISE_SHIFT, so the floor would
+ * only ever go down.
+ */
+static inline void movement_learn(struct movement_t *ptr, int32_t slope)
+{
+	ptr->noise_sum += slope - ptr->noise;
+	if (ptr->noise_sum < (MOVEMENT_NOISE_MIN << MOVEMENT_NOISE_SHIFT))
+		ptr->noise_sum = MOVEMENT_NOISE_MIN << MOVEMENT_NOISE_SHIFT;
+
+	ptr->noise = (ptr->noise_sum + (1 << (MOVEMENT_NOISE_SHIFT - 1))) >> MOVEMENT_NOISE_SHIFT;
+}
+
+// One side of the CUSUM, true if it fired
+static inline bool movement_side(struct movement_t *ptr, int side, int32_t step, int32_t drift, int32_t threshold)
+{
+	if (ptr->sum[side] == 0) {
+		ptr->origin[side] = ptr->last - step;
+		ptr->age[side] = 0;
+	}
+
+	ptr->sum[side] += step - drift;
+	ptr->age[side]++;
+
+	if (ptr->sum[side] <= 0) {
+		ptr->sum[side] = 0;
+		return false;
+	}
+
+	// Past it stays past it, without growing for the whole movement
+	if (ptr->sum[side] > threshold) {
+		ptr->sum[side] = threshold + 1;
+		return true;
+	}
+	return false;
+}
+
+bool movement_update(struct movement_t *ptr, int32_t value, struct movement_event_t *event)
+{
+	int32_t scaled = value << MOVEMENT_SCALE;
+	int32_t delta  = scaled - ptr->last;
+	ptr->last = scaled;
+
+	// Same as the floor, a shifted step would sit lower than the slope
+	ptr->slope_sum += delta - ptr->slope;
+	ptr->slope = (ptr->slope_sum + (1 << (MOVEMENT_SLOPE_SHIFT - 1))) >> MOVEMENT_SLOPE_SHIFT;
+
+	// Settling, from every reading: a floor still at MOVEMENT_NOISE_MIN
+	// on a noisy input would never see it still
+	if (ptr->settle > 0) {
+		ptr->settle--;
+		movement_learn(ptr, abs(ptr->slope));
+		return false;
+	}
+
+	int32_t drift     = ptr->noise * MOVEMENT_DRIFT;
+	int32_t threshold = ptr->noise * MOVEMENT_THRESHOLD;
+
+	// Then only while still, clipped: a turn would drag it up to its own slope
+	if (ptr->direction == 0 && ptr->sum[movement_up] == 0 && ptr->sum[movement_down] == 0)
+		movement_learn(ptr, (abs(ptr->slope) > drift) ? drift : abs(ptr->slope));
+
+	// Still: see if a movement is over
+	if (abs(ptr->slope) <= drift) {
+		if (ptr->direction != 0 && ++ptr->quiet >= MOVEMENT_QUIET_TICKS) {
+			ptr->direction = 0;
+			movement_restart(ptr, movement_up);
+			movement_restart(ptr, movement_down);
+		}
+	} else {
+		ptr->quiet = 0;
+	}
+
+	bool up   = movement_side(ptr, movement_up,    ptr->slope, drift, threshold);
+	bool down = movement_side(ptr, movement_down, -ptr->slope, drift, threshold);
+
+	int side;
+	if (up && ptr->direction != 1)
+		side = movement_up;
+	else if (down && ptr->direction != -1)
+		side = movement_down;
+	else
+		return false;
+
+	ptr->direction = (side == movement_up) ? 1 : -1;
+	ptr->quiet = 0;
+
+	int32_t magnitude = abs(ptr->last - ptr->origin[side]) >> MOVEMENT_SCALE;
+	event->direction = ptr->direction;
+	event->magnitude = (magnitude > UINT16_MAX) ? UINT16_MAX : magnitude;
+	event->onset     = (ptr->age[side] > UINT16_MAX) ? UINT16_MAX : ptr->age[side];
+
+	movement_restart(ptr, movement_up);
+	movement_restart(ptr, movement_down);
+	return true;
+}
+
+bool movement_moving(const struct movement_t *ptr)
+{
+	return ptr->direction != 0;
+}
+
+int32_t movement_noise(const struct movement_t *ptr)
+{
+	return ptr->noise;
+}
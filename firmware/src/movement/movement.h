@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_MOVEMENT_H
+#define HAPTIC_BRACELET_FIRMWARE_MOVEMENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * struct movement_t:
+ *
+ * Tells when an analog input (the aux knob) starts moving, in which
+ * direction and how far, a few readings after it does.
+ *
+ * A lightly filtered derivative goes into a two sided CUSUM: each side
+ * adds up the slope in its direction, minus a drift allowance, and fires
+ * when the sum passes a threshold. Both scale with the noise floor, the
+ * mean absolute slope: from every reading for the first
+ * 2^MOVEMENT_NOISE_SHIFT after init, which don't fire, then only while
+ * still, clipped to the drift allowance, so a turn doesn't drag it up. A
+ * noisy pot doesn't fire on its own and a clean one reacts to small turns.
+ * Drift slower than the allowance never adds up.
+ *
+ * Once moving, only a reversal fires again, until the input has been
+ * still for MOVEMENT_QUIET_TICKS.
+ *
+ * No Pico SDK, host/tools/haptic_replay.cpp runs the same code on recorded
+ * readings. Embedded in the owner, like the filters.
+ */
+struct movement_t {
+	int32_t last;		// reading, scaled
+	int32_t slope;		// filtered derivative, scaled
+	int32_t slope_sum;	// slope << MOVEMENT_SLOPE_SHIFT, for rounding
+	int32_t noise;		// noise floor, scaled
+	int32_t noise_sum;	// noise floor << MOVEMENT_NOISE_SHIFT, for rounding
+	uint32_t settle;	// readings left before it fires
+
+	int32_t  sum[2];	// CUSUM, up and down
+	int32_t  origin[2];	// reading when each sum left 0
+	uint32_t age[2];	// readings since then
+
+	int8_t   direction;	// while moving
+	uint32_t quiet;		// still readings in a row
+};
+
+struct movement_event_t {
+	int8_t   direction;	// +1 up, -1 down
+	uint16_t magnitude;	// ADC counts since the onset
+	uint16_t onset;		// readings ago the movement started
+};
+
+void movement_init(struct movement_t *ptr, int32_t value);
+
+/*
+ * movement_update:
+ *
+ * One reading per tick. True when a movement starts, or reverses.
+ */
+bool movement_update(struct movement_t *ptr, int32_t value, struct movement_event_t *event);
+
+// Are we in a movement?
+bool movement_moving(const struct movement_t *ptr);
+
+// Noise floor, 1/16 ADC counts per reading
+int32_t movement_noise(const struct movement_t *ptr);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_MOVEMENT_H */
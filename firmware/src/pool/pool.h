@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_POOL_H
+#define HAPTIC_BRACELET_FIRMWARE_POOL_H
+
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/malloc.h"
+
+#include "config.h"
+
+/*
+ * POOL:
+ *
+ * Where a module's objects come from, declared once in its .c:
+ *
+ *   POOL(command_link, struct command_link_t, STATIC_COMMAND_LINKS)
+ *
+ * gives command_link_pool_alloc() and command_link_pool_free(). With
+ * STATIC_DEVICES they are handed out in order from an array of count in
+ * .bss, and a full pool panics, at boot, where they are all made. Otherwise malloc() and free(),
+ * and running out panics too. Never NULL either way.
+ */
+#if STATIC_DEVICES
+
+#define POOL(name, type, count) \
+	static type name##_pool[count]; \
+	static uint name##_pool_used = 0; \
+	\
+	static inline type *name##_pool_alloc(void) \
+	{ \
+		if (name##_pool_used >= (count)) \
+			panic(#name ": pool full, raise " #count); \
+		return &(name##_pool[name##_pool_used++]); \
+	} \
+	\
+	static inline void name##_pool_free(__unused type *ptr) \
+	{ \
+	}
+
+#else
+
+#define POOL(name, type, count) \
+	static inline type *name##_pool_alloc(void) \
+	{ \
+		type *ptr = malloc(sizeof(type)); \
+		if (ptr == NULL) \
+			panic(#name ": out of memory"); \
+		return ptr; \
+	} \
+	\
+	static inline void name##_pool_free(type *ptr) \
+	{ \
+		free(ptr); \
+	}
+
+#endif
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_POOL_H */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "counter.h"
+#include "sampler.h"
+
+// 1024 bytes, 512 samples: 12.8 ms at 40 kHz
+#define SAMPLER_RING_BITS    10
+#define SAMPLER_RING_SAMPLES ((1 << SAMPLER_RING_BITS) / sizeof(uint16_t))
+
+// Samples per round
+#define SAMPLER_FRAME __builtin_popcount(ADC_CHANNELS)
+
+_Static_assert((SAMPLER_FRAME & (SAMPLER_FRAME - 1)) == 0,
+	"ADC_CHANNELS must have 1, 2 or 4 channels, rounds have to line up with the ring");
+_Static_assert(SAMPLER_FRAME * ADC_OVERSAMPLE <= SAMPLER_RING_SAMPLES / 2,
+	"ADC_OVERSAMPLE too large for the ring");
+
+// The DMA write address wraps on this alignment
+static volatile uint16_t sampler_ring[SAMPLER_RING_SAMPLES]
+	__attribute__((aligned(1 << SAMPLER_RING_BITS)));
+
+// Read by the control channel, every time the data channel finishes
+static const uint32_t sampler_reload = SAMPLER_RING_SAMPLES;
+
+static int sampler_data = -1;
+static int sampler_control = -1;
+
+// Ring position at the last read, for counting conversions
+static uint32_t sampler_counted;
+
+// Where the next sample goes
+static inline uint32_t sampler_index(void)
+{
+	uintptr_t address = dma_channel_hw_addr(sampler_data)->write_addr;
+	return ((address - (uintptr_t)sampler_ring) / sizeof(uint16_t)) % SAMPLER_RING_SAMPLES;
+}
+
+void sampler_init(void)
+{
+	if (sampler_data >= 0)
+		return;
+
+	for (uint channel = 0; channel < 4; channel++) {
+		if (ADC_CHANNELS & (1u << channel))
+			adc_gpio_init(ADC_BASE_PIN + channel);
+	}
+
+	// Rounds start at the lowest channel and go up
+	adc_select_input(__builtin_ctz(ADC_CHANNELS));
+	adc_set_round_robin(ADC_CHANNELS);
+	adc_fifo_setup(true, true, 1, false, false);
+	adc_set_clkdiv(48000000.0f / ADC_SAMPLE_HZ - 1);
+
+	sampler_data    = dma_claim_unused_channel(true);
+	sampler_control = dma_claim_unused_channel(true);
+
+	dma_channel_config data = dma_channel_get_default_config(sampler_data);
+	channel_config_set_transfer_data_size(&data, DMA_SIZE_16);
+	channel_config_set_read_increment(&data, false);
+	channel_config_set_write_increment(&data, true);
+	channel_config_set_ring(&data, true, SAMPLER_RING_BITS);
+	channel_config_set_dreq(&data, DREQ_ADC);
+	channel_config_set_chain_to(&data, sampler_control);
+	dma_channel_configure(sampler_data, &data, sampler_ring, &adc_hw->fifo, SAMPLER_RING_SAMPLES, false);
+
+	// Writing the count through the trigger alias restarts the data channel
+	dma_channel_config control = dma_channel_get_default_config(sampler_control);
+	channel_config_set_transfer_data_size(&control, DMA_SIZE_32);
+	channel_config_set_read_increment(&control, false);
+	channel_config_set_write_increment(&control, false);
+	dma_channel_configure(sampler_control, &control,
+		&dma_hw->ch[sampler_data].al1_transfer_count_trig, &sampler_reload, 1, false);
+
+	dma_channel_start(sampler_data);
+	adc_run(true);
+
+	// Enough for the first readings, no wrap yet
+	while (sampler_index() < SAMPLER_FRAME * ADC_OVERSAMPLE)
+		tight_loop_contents();
+	sampler_counted = 0;
+}
+
+uint32_t sampler_sum(uint channel)
+{
+	if (!(ADC_CHANNELS & (1u << channel)))
+		return 0;
+
+	// Position in a round, and the end of the last whole round
+	uint32_t index = sampler_index();
+	uint32_t rank  = __builtin_popcount(ADC_CHANNELS & ((1u << channel) - 1));
+	uint32_t end   = index & ~(uint32_t)(SAMPLER_FRAME - 1);
+
+	// Converted since the last read, by how far the DMA got. Read every
+	// tick, well within a ring, none go uncounted.
+	counter_add(counter_adc_samples, (index - sampler_counted) % SAMPLER_RING_SAMPLES);
+	sampler_counted = index;
+
+	uint32_t sum = 0;
+	for (uint32_t i = 1; i <= ADC_OVERSAMPLE; i++)
+		sum += sampler_ring[(end - i * SAMPLER_FRAME + rank) % SAMPLER_RING_SAMPLES];
+
+	return sum;
+}
+
+adc_t sampler_read(uint channel)
+{
+	return (sampler_sum(channel) + ADC_OVERSAMPLE / 2) / ADC_OVERSAMPLE;
+}
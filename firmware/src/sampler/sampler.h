@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_SAMPLER_H
+#define HAPTIC_BRACELET_FIRMWARE_SAMPLER_H
+
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * Sampler:
+ *
+ * The ADC runs on its own, round robin over ADC_CHANNELS at ADC_SAMPLE_HZ,
+ * and DMA moves every conversion into a RAM ring. A second DMA channel
+ * reloads the first whenever it finishes, so it never stops and never
+ * needs the CPU. Readers only add up the latest samples, nothing waits on
+ * a conversion.
+ *
+ * Call once, after adc_init(), before any analog_init().
+ */
+void sampler_init(void);
+
+/*
+ * sampler_sum:
+ *
+ * The channel's last ADC_OVERSAMPLE samples added up. Oversampling by 4^n
+ * and shifting the sum right by n gives 12 + n bits.
+ */
+uint32_t sampler_sum(uint channel);
+
+// Average of the same samples, 12 bits
+adc_t sampler_read(uint channel);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_SAMPLER_H */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "hardware/irq.h"
+#include "pico/stdlib.h"
+
+#include "config_adv.h"
+#include "service.h"
+#include "trace.h"
+
+#define SERVICE_JOBS_MAX 8
+
+static int    service_irq = -1;
+static size_t service_jobs_count = 0;
+static void (*service_jobs[SERVICE_JOBS_MAX])(void);
+
+static void service_handler(void)
+{
+	trace_begin(trace_service, 0);
+	for (size_t i = 0; i < service_jobs_count; i++)
+		service_jobs[i]();
+	trace_end(trace_service, 0);
+}
+
+void service_init(void)
+{
+	if (service_irq >= 0)
+		return;
+
+	service_irq = user_irq_claim_unused(true);
+	irq_set_exclusive_handler(service_irq, service_handler);
+	irq_set_priority(service_irq, PICO_LOWEST_IRQ_PRIORITY);
+	irq_set_enabled(service_irq, true);
+}
+
+void service_add(void (*job)(void))
+{
+	if (service_jobs_count >= SERVICE_JOBS_MAX)
+		panic("service: too many jobs, raise SERVICE_JOBS_MAX");
+
+	// Jobs are only added at init, before the first request.
+	service_jobs[service_jobs_count] = job;
+	service_jobs_count++;
+}
+
+void service_request(void)
+{
+	if (service_irq < 0)
+		return;
+
+	irq_set_pending(service_irq);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_SERVICE_H
+#define HAPTIC_BRACELET_FIRMWARE_SERVICE_H
+
+/*
+ * Service context:
+ *
+ * A software interrupt at the lowest priority. Work that must not stretch
+ * the timer callback (USB, and anything that talks to the host) runs here.
+ * The timer callback and the radio can always preempt it.
+ */
+
+void service_init(void);
+
+/*
+ * service_add:
+ *
+ * Register a job. Every job runs each time the service context runs.
+ * Panics past SERVICE_JOBS_MAX, a lost job would be a log or link never
+ * drained.
+ */
+void service_add(void (*job)(void));
+
+/*
+ * service_request:
+ *
+ * Run the jobs as soon as nothing more important is running.
+ * Safe from any context.
+ */
+void service_request(void);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_SERVICE_H */
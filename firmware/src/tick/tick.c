@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "tick.h"
+#include "timing.h"
+#include "trace.h"
+
+static inline bool tick_fits(const struct tick_task_t *task, uint32_t start)
+{
+	if (task->priority == tick_critical)
+		return true;
+
+	if (task->shed >= TICK_SHED_MAX)
+		return true;
+
+	return time_us_32() - start + task->budget_us <= TICK_BUDGET_US;
+}
+
+void tick_run(struct tick_task_t *tasks, size_t count)
+{
+	uint32_t start = time_us_32();
+
+	for (size_t i = 0; i < count; i++) {
+		struct tick_task_t *task = &tasks[i];
+
+		if (!tick_fits(task, start)) {
+			task->shed++;
+			timing_shed(task->section);
+			continue;
+		}
+
+		trace_begin(trace_task, task->section);
+		task->run();
+		trace_end(trace_task, task->section);
+		task->shed = 0;
+		timing_mark(task->section, task->budget_us);
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_TICK_H
+#define HAPTIC_BRACELET_FIRMWARE_TICK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config_adv.h"
+#include "timing.h"
+
+enum tick_priority {
+	tick_critical,	// every tick, whatever it costs (motor, command dispatch)
+	tick_sheddable	// put off to a later tick when this one is running late
+};
+
+/*
+ * struct tick_task_t:
+ *
+ * One entry of the timer callback's task table. budget_us is what the task
+ * is expected to take: a sheddable task only runs if it still fits in
+ * TICK_BUDGET_US, and any task taking longer counts as an overrun of its
+ * timing section.
+ */
+struct tick_task_t {
+	void (*run)(void);
+	enum timing_section section;
+	enum tick_priority priority;
+	uint32_t budget_us;
+
+	// Ticks put off in a row, by tick_run()
+	uint32_t shed;
+};
+
+/*
+ * tick_run:
+ *
+ * Run the table in order, from the timer callback, after timing_start().
+ * A sheddable task put off TICK_SHED_MAX ticks in a row runs anyway.
+ */
+void tick_run(struct tick_task_t *tasks, size_t count);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_TICK_H */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "counter.h"
+#include "timing.h"
+
+static struct timing_stats_t timing_stats[timing_sections];
+
+// Odd while the timer callback is updating the stats
+static volatile uint32_t _Atomic timing_sequence = 0;
+static volatile bool _Atomic timing_reset_requested = false;
+
+// Timer callback only
+static uint32_t timing_tick_start = 0;
+static uint32_t timing_last_mark  = 0;
+static bool     timing_started    = false;
+
+static const char *const timing_names[timing_sections] = {
+	[timing_tick]   = "tick",
+	[timing_jitter] = "jitter",
+	[timing_led]    = "led",
+	[timing_inputs] = "inputs",
+	[timing_motor]  = "motor",
+	[timing_aux]    = "aux",
+	[timing_pulse]  = "pulse"
+};
+
+static inline void timing_add(enum timing_section section, uint32_t us, uint32_t budget_us)
+{
+	struct timing_stats_t *stats = &timing_stats[section];
+
+	if (stats->count == 0 || us < stats->min)
+		stats->min = us;
+	if (us > stats->max)
+		stats->max = us;
+	if (us > budget_us)
+		stats->overruns++;
+	stats->count++;
+
+	// Bit length: 0 for 0, i for [2^(i-1), 2^i)
+	uint32_t bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+	if (bucket >= TIMING_BUCKETS)
+		bucket = TIMING_BUCKETS - 1;
+	stats->buckets[bucket]++;
+}
+
+void timing_start(void)
+{
+	uint32_t now = time_us_32();
+
+	uint32_t sequence = atomic_load_explicit(&timing_sequence, memory_order_relaxed);
+	atomic_store_explicit(&timing_sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	if (atomic_exchange_explicit(&timing_reset_requested, false, memory_order_relaxed)) {
+		memset(timing_stats, 0, sizeof(timing_stats));
+		timing_started = false;
+	}
+
+	if (timing_started) {
+		int32_t jitter = (int32_t)(now - timing_tick_start - TICK_PERIOD_US);
+		timing_add(timing_jitter, (jitter < 0) ? -jitter : jitter, TIMING_OVERRUN_US);
+	}
+	timing_started = true;
+
+	timing_tick_start = now;
+	timing_last_mark = now;
+}
+
+void timing_mark(enum timing_section section, uint32_t budget_us)
+{
+	uint32_t now = time_us_32();
+	timing_add(section, now - timing_last_mark, budget_us);
+	timing_last_mark = now;
+}
+
+void timing_shed(enum timing_section section)
+{
+	timing_stats[section].shed++;
+	counter_increment(counter_tick_shed);
+	timing_last_mark = time_us_32();
+}
+
+void timing_end(void)
+{
+	uint32_t us = time_us_32() - timing_tick_start;
+	timing_add(timing_tick, us, TIMING_OVERRUN_US);
+	if (us > TIMING_OVERRUN_US)
+		counter_increment(counter_tick_overruns);
+
+	uint32_t sequence = atomic_load_explicit(&timing_sequence, memory_order_relaxed);
+	atomic_store_explicit(&timing_sequence, sequence + 1, memory_order_release);
+}
+
+bool timing_read(struct timing_stats_t stats[timing_sections])
+{
+	// A copy takes a few us, the callback comes once per tick
+	for (int tries = 0; tries < 4; tries++) {
+		uint32_t sequence = atomic_load_explicit(&timing_sequence, memory_order_acquire);
+		if (sequence & 1)
+			continue;
+
+		memcpy(stats, timing_stats, sizeof(timing_stats));
+
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&timing_sequence, memory_order_relaxed) == sequence)
+			return true;
+	}
+	return false;
+}
+
+void timing_reset(void)
+{
+	atomic_store_explicit(&timing_reset_requested, true, memory_order_relaxed);
+}
+
+const char *timing_name(enum timing_section section)
+{
+	if (section >= timing_sections)
+		return "?";
+	return timing_names[section];
+}
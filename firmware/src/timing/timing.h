@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_TIMING_H
+#define HAPTIC_BRACELET_FIRMWARE_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config_adv.h"
+
+/*
+ * Timing:
+ *
+ * Always on timing of the timer callback. Each section's durations go in
+ * a histogram of power of two buckets, in us: bucket 0 is under 1 us,
+ * bucket i holds [2^(i-1), 2^i), the last one everything above. Along with
+ * min, max, how many were over budget (TIMING_OVERRUN_US for the tick and
+ * the jitter, the task's own budget for the others), and how many times a
+ * sheddable task was put off (tick.h).
+ *
+ * timing_jitter is how far a tick started from TICK_PERIOD_US after the
+ * previous one, either way.
+ *
+ * Written by the timer callback only, read from anywhere.
+ */
+
+#define TIMING_BUCKETS 16
+
+enum timing_section {
+	timing_tick,	// the whole callback
+	timing_jitter,
+	timing_led,
+	timing_inputs,	// buttons, aux detect
+	timing_motor,
+	timing_aux,	// aux analog
+	timing_pulse,	// bracelet_pulse(), command dispatch
+	timing_sections
+};
+
+struct timing_stats_t {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t overruns;
+	uint32_t shed;
+	uint32_t buckets[TIMING_BUCKETS];
+};
+
+/*
+ * timing_start:
+ *
+ * The tick begins. Records the jitter, opens the first section.
+ */
+void timing_start(void);
+
+/*
+ * timing_mark:
+ *
+ * The section since the previous mark (or timing_start()) is over, an
+ * overrun if it took more than budget_us.
+ */
+void timing_mark(enum timing_section section, uint32_t budget_us);
+
+/*
+ * timing_shed:
+ *
+ * The section was skipped this tick.
+ */
+void timing_shed(enum timing_section section);
+
+/*
+ * timing_end:
+ *
+ * The tick is over, records timing_tick.
+ */
+void timing_end(void);
+
+/*
+ * timing_read:
+ *
+ * Consistent copy of all sections, as of the last whole tick. False if the
+ * timer callback kept getting in the way.
+ */
+bool timing_read(struct timing_stats_t stats[timing_sections]);
+
+/*
+ * timing_reset:
+ *
+ * Start over, from the next tick.
+ */
+void timing_reset(void);
+
+const char *timing_name(enum timing_section section);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_TIMING_H */
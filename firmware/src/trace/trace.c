@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include "hardware/clocks.h"
+#include "hardware/structs/m33.h"
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "trace.h"
+
+#define TRACE_HEADER_SIZE 16
+#define TRACE_RECORD_SIZE 8
+
+struct trace_record_t {
+	uint32_t cycles;
+	uint8_t  phase;
+	uint8_t  id;
+	uint16_t value;
+};
+
+static struct trace_record_t trace_ring[TRACE_RING_SIZE];
+static volatile uint32_t _Atomic trace_head = 0;	// records written, ever
+static volatile bool _Atomic trace_frozen = false;
+
+// The dump, set by trace_freeze()
+static uint8_t  trace_header[TRACE_HEADER_SIZE];
+static uint32_t trace_first = 0;
+static uint32_t trace_count = 0;
+
+static inline uint32_t trace_cycles(void)
+{
+#if TRACE_ENABLED
+	return m33_hw->dwt_cyccnt;
+#else
+	return 0;
+#endif
+}
+
+#if TRACE_ENABLED
+
+void trace_init(void)
+{
+	m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+	m33_hw->dwt_cyccnt = 0;
+	m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+void trace_add(uint8_t phase, uint8_t id, uint16_t value)
+{
+	if (atomic_load_explicit(&trace_frozen, memory_order_relaxed))
+		return;
+
+	// Claim a slot, whoever preempts us takes the next one
+	uint32_t index = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+	struct trace_record_t *record = &trace_ring[index % TRACE_RING_SIZE];
+
+	record->cycles = trace_cycles();
+	record->phase  = phase;
+	record->id     = id;
+	record->value  = value;
+}
+
+#endif
+
+static inline void trace_put32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = value;
+	buffer[1] = value >> 8;
+	buffer[2] = value >> 16;
+	buffer[3] = value >> 24;
+}
+
+size_t trace_freeze(void)
+{
+	atomic_store_explicit(&trace_frozen, true, memory_order_relaxed);
+
+	uint32_t head = atomic_load_explicit(&trace_head, memory_order_relaxed);
+	trace_count = (head < TRACE_RING_SIZE) ? head : TRACE_RING_SIZE;
+	trace_first = head - trace_count;
+
+	us_t now = us_now();
+	trace_put32(&trace_header[0], clock_get_hz(clk_sys));
+	trace_put32(&trace_header[4], trace_cycles());
+	trace_put32(&trace_header[8], now);
+	trace_put32(&trace_header[12], now >> 32);
+
+	return TRACE_HEADER_SIZE + trace_count * TRACE_RECORD_SIZE;
+}
+
+size_t trace_read(size_t offset, uint8_t *buffer, size_t size)
+{
+	size_t total = TRACE_HEADER_SIZE + trace_count * TRACE_RECORD_SIZE;
+	if (offset >= total)
+		return 0;
+	if (size > total - offset)
+		size = total - offset;
+
+	for (size_t i = 0; i < size; i++, offset++) {
+		if (offset < TRACE_HEADER_SIZE) {
+			buffer[i] = trace_header[offset];
+			continue;
+		}
+
+		size_t record_offset = offset - TRACE_HEADER_SIZE;
+		const struct trace_record_t *record =
+			&trace_ring[(trace_first + record_offset / TRACE_RECORD_SIZE) % TRACE_RING_SIZE];
+
+		uint8_t bytes[TRACE_RECORD_SIZE];
+		trace_put32(bytes, record->cycles);
+		bytes[4] = record->phase;
+		bytes[5] = record->id;
+		bytes[6] = record->value;
+		bytes[7] = record->value >> 8;
+
+		buffer[i] = bytes[record_offset % TRACE_RECORD_SIZE];
+	}
+	return size;
+}
+
+void trace_thaw(void)
+{
+	atomic_store_explicit(&trace_frozen, false, memory_order_relaxed);
+}
+
+void trace_clear(void)
+{
+	atomic_store_explicit(&trace_head, 0, memory_order_relaxed);
+}
+
+uint32_t trace_total(void)
+{
+	return atomic_load_explicit(&trace_head, memory_order_relaxed);
+}
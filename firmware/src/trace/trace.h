@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_TRACE_H
+#define HAPTIC_BRACELET_FIRMWARE_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "config_adv.h"
+
+/*
+ * Trace:
+ *
+ * Flight recorder of what ran when, for working out why a pulse came late.
+ * 8 byte records in a RAM ring (TRACE_RING_SIZE), the oldest overwritten,
+ * timestamped with the CPU cycle counter. Safe from any context, a few
+ * cycles per record. host/tools/haptic_trace.cpp turns a dump into a
+ * Chrome / Perfetto trace.
+ *
+ * Dump, little endian:
+ *   uint32_t hz      CPU clock
+ *   uint32_t cycles  cycle counter at the dump
+ *   uint64_t us      us_now() at the dump
+ * then records, oldest first:
+ *   uint32_t cycles
+ *   uint8_t  phase   enum trace_phase
+ *   uint8_t  id      enum trace_id
+ *   uint16_t value
+ */
+
+enum trace_phase {
+	trace_phase_begin   = 1,
+	trace_phase_end     = 2,
+	trace_phase_instant = 3
+};
+
+enum trace_id {
+	trace_tick    = 1,	// timer callback, value 1 for the GPIO edge callback
+	trace_task    = 2,	// tick task, value: enum timing_section
+	trace_packet  = 3,	// btstack packet handler, value: packet type << 8 | HCI event
+	trace_service = 4,	// service context jobs
+	trace_motor   = 5,	// motor phase change, value: enum motor_states
+	trace_enqueue = 6,	// pulse queued, value: ms
+	trace_dequeue = 7	// pulse started from a command link, value: ms
+};
+
+#if TRACE_ENABLED
+
+void trace_init(void);
+void trace_add(uint8_t phase, uint8_t id, uint16_t value);
+
+#else
+
+static inline void trace_init(void) {}
+static inline void trace_add(uint8_t phase, uint8_t id, uint16_t value) {}
+
+#endif
+
+static inline void trace_begin(uint8_t id, uint16_t value)
+{
+	trace_add(trace_phase_begin, id, value);
+}
+
+static inline void trace_end(uint8_t id, uint16_t value)
+{
+	trace_add(trace_phase_end, id, value);
+}
+
+static inline void trace_instant(uint8_t id, uint16_t value)
+{
+	trace_add(trace_phase_instant, id, value);
+}
+
+/*
+ * trace_freeze:
+ *
+ * Stop recording and take the ring as it is, for trace_read(). Returns
+ * the dump size in bytes.
+ */
+size_t trace_freeze(void);
+
+size_t trace_read(size_t offset, uint8_t *buffer, size_t size);
+
+// Record again, after a dump
+void trace_thaw(void);
+
+void trace_clear(void);
+
+// Records so far, ever
+uint32_t trace_total(void);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_TRACE_H */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_TUSB_CONFIG_H
+#define HAPTIC_BRACELET_FIRMWARE_TUSB_CONFIG_H
+
+#define CFG_TUSB_RHPORT0_MODE   OPT_MODE_DEVICE
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+/*
+ * Two CDC interfaces:
+ * 0: stdio (PRINTF)
+ * 1: commands
+ */
+#define CFG_TUD_CDC             2
+#define CFG_TUD_MSC             0
+#define CFG_TUD_HID             0
+#define CFG_TUD_MIDI            0
+#define CFG_TUD_VENDOR          0
+
+#define CFG_TUD_CDC_RX_BUFSIZE  256
+#define CFG_TUD_CDC_TX_BUFSIZE  256
+#define CFG_TUD_CDC_EP_BUFSIZE  64
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_TUSB_CONFIG_H */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "hardware/irq.h"
+#include "pico/bootrom.h"
+#include "pico/mutex.h"
+#include "pico/stdio/driver.h"
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "command.h"
+#include "counter.h"
+#include "service.h"
+#include "usb.h"
+
+#define USB_ITF_STDIO   0
+#define USB_ITF_COMMAND 1
+
+#define USB_STDIO_TIMEOUT_MS 100
+#define USB_REPLY_TIMEOUT_US 2000
+
+// Guards TinyUSB. The service context only tries it, it never waits.
+static mutex_t usb_mutex;
+static struct command_link_t *usb_commands = NULL;
+
+static bool usb_enter(void)
+{
+	// In an interrupt the holder may be the code we preempted. Don't wait.
+	if (__get_current_exception())
+		return mutex_try_enter(&usb_mutex, NULL);
+
+	return mutex_try_enter_block_until(&usb_mutex, make_timeout_time_ms(USB_STDIO_TIMEOUT_MS));
+}
+
+static void usb_out_chars(const char *buf, int length)
+{
+	if (!usb_enter())
+		return;
+
+	bool in_irq = __get_current_exception();
+	absolute_time_t until = make_timeout_time_ms(USB_STDIO_TIMEOUT_MS);
+
+	int i = 0;
+	while (i < length && tud_cdc_n_connected(USB_ITF_STDIO)) {
+		uint32_t written = tud_cdc_n_write(USB_ITF_STDIO, buf + i, length - i);
+		i += written;
+		if (written != 0)
+			continue;
+
+		// Full. Drop the rest instead of stalling an interrupt.
+		if (in_irq || time_reached(until))
+			break;
+
+		tud_task();
+	}
+	tud_cdc_n_write_flush(USB_ITF_STDIO);
+
+	mutex_exit(&usb_mutex);
+}
+
+static void usb_out_flush(void)
+{
+	if (!usb_enter())
+		return;
+
+	tud_cdc_n_write_flush(USB_ITF_STDIO);
+	mutex_exit(&usb_mutex);
+}
+
+static int usb_in_chars(char *buf, int length)
+{
+	if (!usb_enter())
+		return PICO_ERROR_NO_DATA;
+
+	int ret = PICO_ERROR_NO_DATA;
+	if (tud_cdc_n_available(USB_ITF_STDIO))
+		ret = tud_cdc_n_read(USB_ITF_STDIO, buf, length);
+
+	mutex_exit(&usb_mutex);
+	return ret;
+}
+
+static stdio_driver_t usb_stdio = {
+	.out_chars = usb_out_chars,
+	.out_flush = usb_out_flush,
+	.in_chars  = usb_in_chars
+};
+
+// Only called from usb_service(), with the lock held
+void usb_reply(const char *data, size_t size)
+{
+	if (!tud_cdc_n_connected(USB_ITF_COMMAND))
+		return;
+
+	// A host holding DTR without reading would keep us here forever
+	absolute_time_t until = make_timeout_time_us(USB_REPLY_TIMEOUT_US);
+	while (size > 0) {
+		uint32_t written = tud_cdc_n_write(USB_ITF_COMMAND, data, size);
+		data += written;
+		size -= written;
+		if (written != 0)
+			continue;
+
+		if (time_reached(until)) {
+			counter_add(counter_reply_bytes_dropped, size);
+			break;
+		}
+		tud_task();
+	}
+	tud_cdc_n_write_flush(USB_ITF_COMMAND);
+}
+
+static void usb_service(void)
+{
+	if (!mutex_try_enter(&usb_mutex, NULL))
+		return;
+
+	tud_task();
+
+	uint8_t buffer[CFG_TUD_CDC_EP_BUFSIZE];
+	while (tud_cdc_n_available(USB_ITF_COMMAND)) {
+		uint32_t length = tud_cdc_n_read(USB_ITF_COMMAND, buffer, sizeof(buffer));
+		command_receive(usb_commands, buffer, length);
+	}
+	command_service(usb_commands);
+
+	// Bulk data, as much as fits
+	uint8_t bulk[CFG_TUD_CDC_TX_BUFSIZE];
+	while (tud_cdc_n_connected(USB_ITF_COMMAND)) {
+		uint32_t space = tud_cdc_n_write_available(USB_ITF_COMMAND);
+		size_t length = command_read(usb_commands, bulk, space < sizeof(bulk) ? space : sizeof(bulk));
+		if (length == 0)
+			break;
+
+		tud_cdc_n_write(USB_ITF_COMMAND, bulk, length);
+	}
+	tud_cdc_n_write_flush(USB_ITF_COMMAND);
+
+	mutex_exit(&usb_mutex);
+}
+
+static void usb_irq(void)
+{
+	// TinyUSB's own handler has already run, finish the work outside of it.
+	service_request();
+}
+
+// picotool and the IDE reboot the board into BOOTSEL with a 1200 baud touch.
+void tud_cdc_line_coding_cb(uint8_t itf, const cdc_line_coding_t *line_coding)
+{
+	if (itf == USB_ITF_STDIO && line_coding->bit_rate == 1200)
+		reset_usb_boot(0, 0);
+}
+
+void usb_init(struct command_link_t *commands)
+{
+	usb_commands = commands;
+	mutex_init(&usb_mutex);
+
+	tusb_init();
+	irq_add_shared_handler(USBCTRL_IRQ, usb_irq, PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+
+	service_init();
+	service_add(usb_service);
+
+	stdio_set_driver_enabled(&usb_stdio, true);
+}
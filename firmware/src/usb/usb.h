@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_FIRMWARE_USB_H
+#define HAPTIC_BRACELET_FIRMWARE_USB_H
+
+#include "command.h"
+
+/*
+ * usb_init:
+ *
+ * Bring up the USB device with two CDC interfaces. The first one carries
+ * stdio (replaces pico_enable_stdio_usb), the second one feeds commands.
+ * Both are serviced from the service context, never from the timer callback.
+ */
+void usb_init(struct command_link_t *commands);
+
+/*
+ * usb_reply:
+ *
+ * command_reply_t for the command interface.
+ */
+void usb_reply(const char *data, size_t size);
+
+#endif /* HAPTIC_BRACELET_FIRMWARE_USB_H */
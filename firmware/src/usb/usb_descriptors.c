@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <string.h>
+#include "pico/unique_id.h"
+#include "tusb.h"
+
+#include "usb.h"
+
+#define USB_VID 0xCafe
+#define USB_PID 0x4002
+
+enum {
+	ITF_NUM_STDIO,
+	ITF_NUM_STDIO_DATA,
+	ITF_NUM_COMMAND,
+	ITF_NUM_COMMAND_DATA,
+	ITF_NUM_TOTAL
+};
+
+enum {
+	STRID_LANGID,
+	STRID_MANUFACTURER,
+	STRID_PRODUCT,
+	STRID_SERIAL,
+	STRID_STDIO,
+	STRID_COMMAND,
+	STRID_COUNT
+};
+
+#define EPNUM_STDIO_NOTIF   0x81
+#define EPNUM_STDIO_OUT     0x02
+#define EPNUM_STDIO_IN      0x82
+#define EPNUM_COMMAND_NOTIF 0x83
+#define EPNUM_COMMAND_OUT   0x04
+#define EPNUM_COMMAND_IN    0x84
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_CDC * TUD_CDC_DESC_LEN)
+
+static const tusb_desc_device_t desc_device = {
+	.bLength            = sizeof(tusb_desc_device_t),
+	.bDescriptorType    = TUSB_DESC_DEVICE,
+	.bcdUSB             = 0x0200,
+
+	// Interface Association Descriptors
+	.bDeviceClass       = TUSB_CLASS_MISC,
+	.bDeviceSubClass    = MISC_SUBCLASS_COMMON,
+	.bDeviceProtocol    = MISC_PROTOCOL_IAD,
+	.bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+
+	.idVendor           = USB_VID,
+	.idProduct          = USB_PID,
+	.bcdDevice          = 0x0100,
+
+	.iManufacturer      = STRID_MANUFACTURER,
+	.iProduct           = STRID_PRODUCT,
+	.iSerialNumber      = STRID_SERIAL,
+
+	.bNumConfigurations = 1
+};
+
+static const uint8_t desc_configuration[] = {
+	TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, 250),
+	TUD_CDC_DESCRIPTOR(ITF_NUM_STDIO,   STRID_STDIO,   EPNUM_STDIO_NOTIF,   8, EPNUM_STDIO_OUT,   EPNUM_STDIO_IN,   64),
+	TUD_CDC_DESCRIPTOR(ITF_NUM_COMMAND, STRID_COMMAND, EPNUM_COMMAND_NOTIF, 8, EPNUM_COMMAND_OUT, EPNUM_COMMAND_IN, 64)
+};
+
+static const char *desc_strings[STRID_COUNT] = {
+	[STRID_MANUFACTURER] = "Haptic Bracelet",
+	[STRID_PRODUCT]      = "Haptic Bracelet",
+	[STRID_SERIAL]       = NULL, // board id
+	[STRID_STDIO]        = "Haptic Bracelet stdio",
+	[STRID_COMMAND]      = "Haptic Bracelet commands"
+};
+
+const uint8_t *tud_descriptor_device_cb(void)
+{
+	return (const uint8_t *)&desc_device;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(__unused uint8_t index)
+{
+	return desc_configuration;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, __unused uint16_t langid)
+{
+	static uint16_t desc_str[32 + 1];
+	static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+
+	size_t length = 0;
+	if (index == STRID_LANGID) {
+		desc_str[1] = 0x0409; // English
+		length = 1;
+	} else {
+		if (index >= STRID_COUNT)
+			return NULL;
+
+		const char *str = desc_strings[index];
+		if (index == STRID_SERIAL) {
+			pico_get_unique_board_id_string(serial, sizeof(serial));
+			str = serial;
+		}
+
+		length = strlen(str);
+		if (length > 32)
+			length = 32;
+
+		for (size_t i = 0; i < length; i++)
+			desc_str[1 + i] = str[i];
+	}
+
+	// First byte is the length (in bytes), second is the string type
+	desc_str[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * length + 2));
+	return desc_str;
+}
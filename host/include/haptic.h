@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_HOST_HAPTIC_H
+#define HAPTIC_BRACELET_HOST_HAPTIC_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+	#if defined(HAPTIC_BUILD)
+		#define HAPTIC_API __declspec(dllexport)
+	#else
+		#define HAPTIC_API __declspec(dllimport)
+	#endif
+#else
+	#define HAPTIC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * haptic_link:
+ *
+ * One bracelet, over its RFCOMM or USB command serial port. The port is
+ * owned by a background I/O thread: it opens, reconnects, writes and
+ * pings. None of the functions below ever touch the port, so they are
+ * safe to call from a render loop.
+ *
+ * Submission is single producer: call haptic_pulse()/haptic_flush() from
+ * one thread per link.
+ */
+typedef struct haptic_link haptic_link;
+
+#define HAPTIC_STATS_WINDOW 256
+
+struct haptic_stats {
+	int32_t  connected;		// the port is open
+	uint32_t reconnects;		// times the port was (re)opened
+
+	uint64_t pulses;		// pulses written
+	uint64_t batches;		// writes (one per flushed frame)
+	uint64_t dropped;		// pulses lost to a full queue or a closed port
+
+	// Round trip of pings, over the last HAPTIC_STATS_WINDOW samples
+	uint32_t rtt_samples;
+	double   rtt_min_us;
+	double   rtt_mean_us;
+	double   rtt_p50_us;
+	double   rtt_p99_us;
+	double   rtt_max_us;
+
+	// Device clock minus host clock, from the lowest round trip ping
+	int32_t  clock_synced;
+	int64_t  clock_offset_us;
+};
+
+/*
+ * haptic_open:
+ *
+ * port: "COM5", "/dev/rfcomm0", "/dev/ttyACM1", ...
+ *       NULL or "" scans every serial port and keeps the first one that
+ *       answers a ping.
+ *
+ * Returns immediately, the port is opened in the background.
+ */
+HAPTIC_API haptic_link *haptic_open(const char *port);
+HAPTIC_API void haptic_close(haptic_link *link);
+
+/*
+ * haptic_pulse:
+ *
+ * Add a pulse of ms milliseconds to the current frame. Nothing is sent
+ * until haptic_flush().
+ */
+HAPTIC_API void haptic_pulse(haptic_link *link, uint32_t ms);
+
+/*
+ * haptic_flush:
+ *
+ * End of frame: hand every pulse added since the last flush to the I/O
+ * thread as a single write. Returns the number of pulses submitted, or
+ * -1 if the queue was full and they were dropped.
+ */
+HAPTIC_API int32_t haptic_flush(haptic_link *link);
+
+HAPTIC_API void haptic_get_stats(haptic_link *link, struct haptic_stats *stats);
+
+/*
+ * haptic_now_us:
+ *
+ * The host clock used for every timestamp (monotonic, microseconds).
+ */
+HAPTIC_API int64_t haptic_now_us(void);
+
+/*
+ * haptic_device_time_us:
+ *
+ * Convert a host timestamp to the device clock. Returns -1 until the
+ * first ping has been answered.
+ */
+HAPTIC_API int64_t haptic_device_time_us(haptic_link *link, int64_t host_us);
+
+/*
+ * haptic_session:
+ *
+ * Several bracelets driven together (one per wrist, ...). Each device
+ * keeps its own link; pulses sent to several devices are scheduled on
+ * each device clock so they start at the same host instant.
+ *
+ * Same threading rule as haptic_link: one submitting thread per session.
+ */
+typedef struct haptic_session haptic_session;
+
+HAPTIC_API haptic_session *haptic_session_new(void);
+HAPTIC_API void haptic_session_free(haptic_session *session);
+
+/*
+ * haptic_session_add:
+ *
+ * Returns the device index (bit in the masks below), -1 on error.
+ */
+HAPTIC_API int32_t haptic_session_add(haptic_session *session, const char *port);
+
+/*
+ * haptic_session_link:
+ *
+ * The link of one device, for stats or single device pulses. Owned by
+ * the session.
+ */
+HAPTIC_API haptic_link *haptic_session_link(haptic_session *session, int32_t index);
+
+/*
+ * haptic_session_pulse:
+ *
+ * ms long pulses on every device in mask, starting lead_us from now.
+ * lead_us < 0 uses the smallest lead that the slowest link can meet
+ * (its p99 round trip, plus one firmware tick).
+ *
+ * Returns the host time (haptic_now_us()) the pulses are due at.
+ */
+HAPTIC_API int64_t haptic_session_pulse(haptic_session *session, uint32_t mask, uint32_t ms, int64_t lead_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAPTIC_BRACELET_HOST_HAPTIC_H */
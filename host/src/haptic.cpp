@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <new>
+
+#include "haptic.h"
+#include "link.hpp"
+#include "session.hpp"
+
+// The C handles are the C++ objects, never dereferenced as C structs
+static haptic::link *to_cpp(haptic_link *link)
+{
+	return reinterpret_cast<haptic::link *>(link);
+}
+
+static haptic::session *to_cpp(haptic_session *session)
+{
+	return reinterpret_cast<haptic::session *>(session);
+}
+
+haptic_link *haptic_open(const char *port)
+{
+	haptic::link *link = new (std::nothrow) haptic::link(port != nullptr ? port : "");
+	return reinterpret_cast<haptic_link *>(link);
+}
+
+void haptic_close(haptic_link *link)
+{
+	delete to_cpp(link);
+}
+
+void haptic_pulse(haptic_link *link, uint32_t ms)
+{
+	if (link == nullptr)
+		return;
+
+	to_cpp(link)->pulse(ms);
+}
+
+int32_t haptic_flush(haptic_link *link)
+{
+	if (link == nullptr)
+		return -1;
+
+	return to_cpp(link)->flush();
+}
+
+void haptic_get_stats(haptic_link *link, struct haptic_stats *stats)
+{
+	if (link == nullptr || stats == nullptr)
+		return;
+
+	to_cpp(link)->stats(*stats);
+}
+
+int64_t haptic_now_us(void)
+{
+	return haptic::now_us();
+}
+
+int64_t haptic_device_time_us(haptic_link *link, int64_t host_us)
+{
+	if (link == nullptr)
+		return -1;
+
+	return to_cpp(link)->device_time_us(host_us);
+}
+
+haptic_session *haptic_session_new(void)
+{
+	haptic::session *session = new (std::nothrow) haptic::session();
+	return reinterpret_cast<haptic_session *>(session);
+}
+
+void haptic_session_free(haptic_session *session)
+{
+	delete to_cpp(session);
+}
+
+int32_t haptic_session_add(haptic_session *session, const char *port)
+{
+	if (session == nullptr)
+		return -1;
+
+	return to_cpp(session)->add(port != nullptr ? port : "");
+}
+
+haptic_link *haptic_session_link(haptic_session *session, int32_t index)
+{
+	if (session == nullptr || index < 0)
+		return nullptr;
+
+	return reinterpret_cast<haptic_link *>(to_cpp(session)->at(index));
+}
+
+int64_t haptic_session_pulse(haptic_session *session, uint32_t mask, uint32_t ms, int64_t lead_us)
+{
+	if (session == nullptr)
+		return -1;
+
+	return to_cpp(session)->pulse(mask, ms, lead_us);
+}
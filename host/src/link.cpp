@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "link.hpp"
+
+namespace haptic {
+
+// Steady pings keep the clock offset fresh despite crystal drift
+static constexpr int64_t ping_fast_us   = 50000;
+static constexpr int64_t ping_period_us = 250000;
+static constexpr uint32_t ping_fast_count = 8;
+
+static constexpr int64_t probe_timeout_us = 300000;
+static constexpr int64_t reconnect_us     = 500000;
+
+int64_t now_us()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void clock_sync::add(int64_t sent_us, int64_t device_us, int64_t received_us)
+{
+	sample s;
+	s.rtt    = received_us - sent_us;
+	s.offset = device_us - (sent_us + received_us) / 2;
+
+	samples[next] = s;
+	next = (next + 1) % window;
+	if (count < window)
+		count++;
+
+	size_t best = 0;
+	for (size_t i = 1; i < count; i++) {
+		if (samples[i].rtt < samples[best].rtt)
+			best = i;
+	}
+	offset = samples[best].offset;
+}
+
+void latency_stats::add(int64_t rtt_us)
+{
+	samples[next] = rtt_us;
+	next = (next + 1) % samples.size();
+	if (count < samples.size())
+		count++;
+}
+
+void latency_stats::fill(haptic_stats &stats) const
+{
+	stats.rtt_samples = static_cast<uint32_t>(count);
+	if (count == 0)
+		return;
+
+	std::vector<int64_t> sorted(samples.begin(), samples.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0;
+	for (int64_t rtt : sorted)
+		sum += rtt;
+
+	stats.rtt_min_us  = sorted.front();
+	stats.rtt_max_us  = sorted.back();
+	stats.rtt_mean_us = sum / count;
+	stats.rtt_p50_us  = sorted[count / 2];
+	stats.rtt_p99_us  = sorted[std::min(count - 1, count * 99 / 100)];
+}
+
+link::link(std::string port) : port_name(std::move(port))
+{
+	thread = std::thread(&link::run, this);
+}
+
+link::~link()
+{
+	running.store(false, std::memory_order_release);
+	port.wake();
+	thread.join();
+}
+
+void link::submit()
+{
+	if (current.length == 0)
+		return;
+
+	if (queue.push(current)) {
+		frame_pulses += current.pulses;
+	} else {
+		pulses_dropped.fetch_add(current.pulses, std::memory_order_relaxed);
+		frame_dropped = true;
+	}
+
+	current.length = 0;
+	current.pulses = 0;
+}
+
+void link::append(const char *line, size_t length, uint32_t pulses)
+{
+	if (length > sizeof(current.data))
+		return;
+
+	if (current.length + length > sizeof(current.data))
+		submit();
+
+	std::memcpy(current.data + current.length, line, length);
+	current.length += static_cast<uint32_t>(length);
+	current.pulses += pulses;
+}
+
+void link::pulse(uint32_t ms)
+{
+	if (ms == 0)
+		return;
+
+	// The firmware takes up to two pulses per line
+	if (pending_ms == 0) {
+		pending_ms = ms;
+		return;
+	}
+
+	char line[32];
+	int length = std::snprintf(line, sizeof(line), "%" PRIu32 " %" PRIu32 "\n", pending_ms, ms);
+	append(line, length, 2);
+	pending_ms = 0;
+}
+
+void link::schedule(uint32_t id, int64_t device_us, uint32_t ms)
+{
+	if (ms == 0 || device_us < 0)
+		return;
+
+	char line[64];
+	int length = std::snprintf(line, sizeof(line), "s %" PRIu32 " %" PRId64 " %" PRIu32 "\n", id, device_us, ms);
+	append(line, length, 1);
+}
+
+int32_t link::flush()
+{
+	if (pending_ms != 0) {
+		char line[32];
+		int length = std::snprintf(line, sizeof(line), "%" PRIu32 "\n", pending_ms);
+		append(line, length, 1);
+		pending_ms = 0;
+	}
+	submit();
+	port.wake();
+
+	int32_t ret = frame_dropped ? -1 : static_cast<int32_t>(frame_pulses);
+	frame_dropped = false;
+	frame_pulses = 0;
+	return ret;
+}
+
+void link::stats(haptic_stats &stats)
+{
+	stats = haptic_stats{};
+	stats.connected  = connected();
+	stats.reconnects = reconnects.load(std::memory_order_relaxed);
+	stats.pulses     = pulses_sent.load(std::memory_order_relaxed);
+	stats.batches    = batches_sent.load(std::memory_order_relaxed);
+	stats.dropped    = pulses_dropped.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	latency.fill(stats);
+	stats.clock_synced    = clock.synced();
+	stats.clock_offset_us = clock.offset_us();
+}
+
+int64_t link::device_time_us(int64_t host_us)
+{
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	if (!clock.synced())
+		return -1;
+
+	return host_us + clock.offset_us();
+}
+
+int64_t link::rtt_p99_us()
+{
+	haptic_stats stats{};
+
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	if (latency.size() == 0)
+		return -1;
+
+	latency.fill(stats);
+	return static_cast<int64_t>(stats.rtt_p99_us);
+}
+
+bool link::ping()
+{
+	ping_token++;
+	ping_sent[ping_token % ping_sent.size()] = now_us();
+
+	char line[32];
+	int length = std::snprintf(line, sizeof(line), "p %" PRIu32 "\n", ping_token);
+	return port.write(line, length);
+}
+
+void link::parse_line(const std::string &line)
+{
+	uint32_t token = 0;
+	unsigned long long device_us = 0;
+	if (std::sscanf(line.c_str(), "P %" SCNu32 " %llu", &token, &device_us) != 2)
+		return;
+
+	// Too old, the slot has been reused
+	if (token > ping_token || ping_token - token >= ping_sent.size())
+		return;
+
+	int64_t sent = ping_sent[token % ping_sent.size()];
+	int64_t received = now_us();
+	ping_answered = true;
+
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	clock.add(sent, static_cast<int64_t>(device_us), received);
+	latency.add(received - sent);
+}
+
+void link::receive(const char *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] == '\n' || data[i] == '\r') {
+			if (!input.empty())
+				parse_line(input);
+			input.clear();
+			continue;
+		}
+
+		// Not ours (stdio, noise), don't grow forever
+		if (input.size() < 256)
+			input.push_back(data[i]);
+	}
+}
+
+bool link::try_port(const std::string &name, bool require_reply)
+{
+	if (!port.open(name))
+		return false;
+
+	input.clear();
+	if (!require_reply)
+		return true;
+
+	ping_answered = false;
+	if (!ping()) {
+		port.close();
+		return false;
+	}
+
+	int64_t until = now_us() + probe_timeout_us;
+	char buffer[256];
+	while (!ping_answered && now_us() < until && running.load(std::memory_order_acquire)) {
+		long length = port.read(buffer, sizeof(buffer), 10);
+		if (length < 0)
+			break;
+		receive(buffer, length);
+	}
+
+	if (!ping_answered)
+		port.close();
+
+	return ping_answered;
+}
+
+bool link::connect()
+{
+	if (!port_name.empty())
+		return try_port(port_name, false);
+
+	for (const std::string &name : serial_port::list()) {
+		if (try_port(name, true))
+			return true;
+	}
+	return false;
+}
+
+void link::disconnect()
+{
+	port.close();
+	is_connected.store(false, std::memory_order_release);
+}
+
+void link::run()
+{
+	char buffer[256];
+
+	while (running.load(std::memory_order_acquire)) {
+		if (!port.is_open()) {
+			// Stale haptics are worse than none
+			batch b;
+			while (queue.pop(b))
+				pulses_dropped.fetch_add(b.pulses, std::memory_order_relaxed);
+
+			if (!connect()) {
+				int64_t until = now_us() + reconnect_us;
+				while (now_us() < until && running.load(std::memory_order_acquire))
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+
+			reconnects.fetch_add(1, std::memory_order_relaxed);
+			is_connected.store(true, std::memory_order_release);
+			ping_count = 0;
+			ping_next = now_us();
+		}
+
+		batch b;
+		while (queue.pop(b)) {
+			if (!port.write(b.data, b.length)) {
+				pulses_dropped.fetch_add(b.pulses, std::memory_order_relaxed);
+				disconnect();
+				break;
+			}
+			pulses_sent.fetch_add(b.pulses, std::memory_order_relaxed);
+			batches_sent.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (!port.is_open())
+			continue;
+
+		int64_t now = now_us();
+		if (now >= ping_next) {
+			if (!ping()) {
+				disconnect();
+				continue;
+			}
+			ping_count++;
+			ping_next = now + (ping_count < ping_fast_count ? ping_fast_us : ping_period_us);
+		}
+
+		int timeout_ms = static_cast<int>((ping_next - now) / 1000);
+		timeout_ms = std::clamp(timeout_ms, 0, 100);
+
+		long length = port.read(buffer, sizeof(buffer), timeout_ms);
+		if (length < 0) {
+			disconnect();
+			continue;
+		}
+		receive(buffer, length);
+	}
+
+	port.close();
+}
+
+} // namespace haptic
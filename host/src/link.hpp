@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_HOST_LINK_HPP
+#define HAPTIC_BRACELET_HOST_LINK_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "haptic.h"
+#include "serial.hpp"
+#include "spsc_queue.hpp"
+
+namespace haptic {
+
+int64_t now_us();
+
+/*
+ * batch:
+ *
+ * One frame worth of command lines, written with a single write().
+ */
+struct batch {
+	uint32_t pulses;
+	uint32_t length;
+	char     data[248];
+};
+
+/*
+ * clock_sync:
+ *
+ * NTP style: each ping gives (sent, device, received). The device time is
+ * assumed to sit in the middle of the round trip; the sample with the
+ * lowest round trip in the window is the least disturbed one.
+ */
+class clock_sync {
+public:
+	void add(int64_t sent_us, int64_t device_us, int64_t received_us);
+	bool synced() const { return count > 0; }
+	int64_t offset_us() const { return offset; }
+
+private:
+	struct sample {
+		int64_t rtt;
+		int64_t offset;
+	};
+
+	static constexpr size_t window = 8;
+	std::array<sample, window> samples;
+	size_t count = 0;
+	size_t next = 0;
+	int64_t offset = 0;
+};
+
+class latency_stats {
+public:
+	void add(int64_t rtt_us);
+	void fill(haptic_stats &stats) const;
+	size_t size() const { return count; }
+
+private:
+	std::array<int64_t, HAPTIC_STATS_WINDOW> samples;
+	size_t count = 0;
+	size_t next = 0;
+};
+
+class link {
+public:
+	explicit link(std::string port);
+	~link();
+
+	link(const link &) = delete;
+	link &operator=(const link &) = delete;
+
+	// Producer thread
+	void pulse(uint32_t ms);
+	void schedule(uint32_t id, int64_t device_us, uint32_t ms);
+	int32_t flush();
+	void append(const char *line, size_t length, uint32_t pulses);
+
+	// Any thread
+	void stats(haptic_stats &stats);
+	int64_t device_time_us(int64_t host_us);
+	int64_t rtt_p99_us();
+	bool connected() const { return is_connected.load(std::memory_order_acquire); }
+
+private:
+	void submit();
+	void run();
+	bool connect();
+	bool try_port(const std::string &name, bool require_reply);
+	bool ping();
+	void receive(const char *data, size_t size);
+	void parse_line(const std::string &line);
+	void disconnect();
+
+	const std::string port_name;
+	serial_port port;
+	std::thread thread;
+	std::atomic<bool> running{true};
+	std::atomic<bool> is_connected{false};
+
+	// Producer side
+	batch current{};
+	uint32_t pending_ms = 0; // odd pulse, waiting for a pair
+	bool frame_dropped = false;
+	uint32_t frame_pulses = 0;
+	spsc_queue<batch, 64> queue;
+
+	// I/O thread
+	std::string input;
+	bool ping_answered = false;
+	uint32_t ping_token = 0;
+	std::array<int64_t, 16> ping_sent{};
+	int64_t ping_next = 0;
+	uint32_t ping_count = 0;
+
+	// Shared
+	std::mutex stats_mutex;
+	clock_sync clock;
+	latency_stats latency;
+	std::atomic<uint64_t> pulses_sent{0};
+	std::atomic<uint64_t> batches_sent{0};
+	std::atomic<uint64_t> pulses_dropped{0};
+	std::atomic<uint32_t> reconnects{0};
+};
+
+} // namespace haptic
+
+#endif /* HAPTIC_BRACELET_HOST_LINK_HPP */
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <chrono>
+#include <cstdio>
+
+#include "serial.hpp"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <glob.h>
+	#include <poll.h>
+	#include <termios.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+namespace haptic {
+
+serial_port::serial_port()
+{
+#if defined(_WIN32)
+	// Auto reset, a wake() before the wait isn't lost
+	wake_event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+	comm_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	io_event   = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+#else
+	// Created up front, wake() may be called from another thread at any time
+	if (pipe(wake_pipe) == 0) {
+		fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+	}
+#endif
+}
+
+serial_port::~serial_port()
+{
+	close();
+#if defined(_WIN32)
+	void *events[] = {wake_event, comm_event, io_event};
+	for (void *event : events) {
+		if (event != nullptr)
+			CloseHandle(static_cast<HANDLE>(event));
+	}
+#else
+	if (wake_pipe[0] >= 0) {
+		::close(wake_pipe[0]);
+		::close(wake_pipe[1]);
+	}
+#endif
+}
+
+#if defined(_WIN32)
+
+bool serial_port::open(const std::string &name)
+{
+	close();
+
+	// "\\.\" is required for COM10 and above
+	std::string path = "\\\\.\\" + name;
+	HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED, nullptr);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+
+	DCB dcb = {};
+	dcb.DCBlength = sizeof(dcb);
+	GetCommState(h, &dcb);
+	dcb.BaudRate = CBR_115200;
+	dcb.ByteSize = 8;
+	dcb.Parity   = NOPARITY;
+	dcb.StopBits = ONESTOPBIT;
+	dcb.fDtrControl = DTR_CONTROL_ENABLE;
+	dcb.fRtsControl = RTS_CONTROL_ENABLE;
+	dcb.fOutxCtsFlow = FALSE;
+	dcb.fOutxDsrFlow = FALSE;
+	if (!SetCommState(h, &dcb)) {
+		CloseHandle(h);
+		return false;
+	}
+
+	// Reads return what is there right away, read() waits for EV_RXCHAR
+	COMMTIMEOUTS timeouts = {};
+	timeouts.ReadIntervalTimeout         = MAXDWORD;
+	timeouts.ReadTotalTimeoutMultiplier  = 0;
+	timeouts.ReadTotalTimeoutConstant    = 0;
+	timeouts.WriteTotalTimeoutConstant   = 100;
+	if (!SetCommTimeouts(h, &timeouts) || !SetCommMask(h, EV_RXCHAR)) {
+		CloseHandle(h);
+		return false;
+	}
+
+	handle = h;
+	port_name = name;
+	return true;
+}
+
+void serial_port::close()
+{
+	if (handle != nullptr)
+		CloseHandle(static_cast<HANDLE>(handle));
+	handle = nullptr;
+}
+
+bool serial_port::is_open() const
+{
+	return handle != nullptr;
+}
+
+bool serial_port::write(const char *data, size_t size)
+{
+	HANDLE h = static_cast<HANDLE>(handle);
+	while (size > 0) {
+		OVERLAPPED ov = {};
+		ov.hEvent = static_cast<HANDLE>(io_event);
+
+		// Completes within WriteTotalTimeoutConstant
+		DWORD written = 0;
+		if (!WriteFile(h, data, static_cast<DWORD>(size), nullptr, &ov) &&
+		    GetLastError() != ERROR_IO_PENDING)
+			return false;
+		if (!GetOverlappedResult(h, &ov, &written, TRUE))
+			return false;
+		if (written == 0)
+			return false;
+
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+// Whatever is buffered, without waiting
+long serial_port::read_now(char *data, size_t size)
+{
+	HANDLE h = static_cast<HANDLE>(handle);
+	OVERLAPPED ov = {};
+	ov.hEvent = static_cast<HANDLE>(io_event);
+
+	DWORD length = 0;
+	if (!ReadFile(h, data, static_cast<DWORD>(size), nullptr, &ov) &&
+	    GetLastError() != ERROR_IO_PENDING)
+		return -1;
+	if (!GetOverlappedResult(h, &ov, &length, TRUE))
+		return -1;
+	return length;
+}
+
+long serial_port::read(char *data, size_t size, int timeout_ms)
+{
+	HANDLE h = static_cast<HANDLE>(handle);
+	if (h == nullptr)
+		return -1;
+
+	ULONGLONG deadline = GetTickCount64() + (timeout_ms > 0 ? timeout_ms : 0);
+	for (;;) {
+		long length = read_now(data, size);
+		if (length != 0)
+			return length;
+
+		ULONGLONG now = GetTickCount64();
+		if (now >= deadline)
+			return 0;
+
+		// EV_RXCHAR is remembered since the last wait, so it may fire for
+		// bytes read above, the loop reads nothing and waits again
+		OVERLAPPED ov = {};
+		ov.hEvent = static_cast<HANDLE>(comm_event);
+		DWORD mask = 0;
+		if (WaitCommEvent(h, &mask, &ov))
+			continue;
+		if (GetLastError() != ERROR_IO_PENDING)
+			return -1;
+
+		HANDLE events[2] = {static_cast<HANDLE>(comm_event), static_cast<HANDLE>(wake_event)};
+		DWORD rc = WaitForMultipleObjects(2, events, FALSE, static_cast<DWORD>(deadline - now));
+
+		// The wait owns mask and ov until it completes
+		DWORD unused = 0;
+		if (rc != WAIT_OBJECT_0)
+			CancelIoEx(h, &ov);
+		bool ok = GetOverlappedResult(h, &ov, &unused, TRUE) || GetLastError() == ERROR_OPERATION_ABORTED;
+		if (!ok)
+			return -1;
+
+		if (rc == WAIT_OBJECT_0 + 1)
+			return 0;
+		if (rc == WAIT_FAILED)
+			return -1;
+	}
+}
+
+void serial_port::wake()
+{
+	if (wake_event != nullptr)
+		SetEvent(static_cast<HANDLE>(wake_event));
+}
+
+std::vector<std::string> serial_port::list()
+{
+	std::vector<std::string> ret;
+	char target[256];
+	for (int i = 1; i <= 64; i++) {
+		std::string name = "COM" + std::to_string(i);
+		if (QueryDosDeviceA(name.c_str(), target, sizeof(target)) != 0)
+			ret.push_back(name);
+	}
+	return ret;
+}
+
+#else
+
+bool serial_port::open(const std::string &name)
+{
+	close();
+
+	int new_fd = ::open(name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (new_fd < 0)
+		return false;
+
+	struct termios tty;
+	if (tcgetattr(new_fd, &tty) == 0) {
+		cfmakeraw(&tty);
+		cfsetispeed(&tty, B115200);
+		cfsetospeed(&tty, B115200);
+		tty.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(new_fd, TCSANOW, &tty);
+	}
+
+	fd = new_fd;
+	port_name = name;
+	return true;
+}
+
+void serial_port::close()
+{
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+
+bool serial_port::is_open() const
+{
+	return fd >= 0;
+}
+
+bool serial_port::write(const char *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t written = ::write(fd, data, size);
+		if (written < 0) {
+			if (errno != EAGAIN && errno != EINTR)
+				return false;
+
+			struct pollfd pfd = {fd, POLLOUT, 0};
+			if (poll(&pfd, 1, 100) <= 0)
+				return false;
+			continue;
+		}
+
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+long serial_port::read(char *data, size_t size, int timeout_ms)
+{
+	struct pollfd pfd[2] = {
+		{fd, POLLIN, 0},
+		{wake_pipe[0], POLLIN, 0}
+	};
+	if (fd < 0)
+		return -1;
+
+	int rc = poll(pfd, 2, timeout_ms);
+	if (rc < 0)
+		return (errno == EINTR) ? 0 : -1;
+
+	if (pfd[1].revents & POLLIN) {
+		char drain[64];
+		while (::read(wake_pipe[0], drain, sizeof(drain)) > 0);
+	}
+
+	if (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+		return -1;
+
+	if (!(pfd[0].revents & POLLIN))
+		return 0;
+
+	ssize_t length = ::read(fd, data, size);
+	if (length < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+	// Readable but empty: the device went away
+	if (length == 0)
+		return -1;
+
+	return length;
+}
+
+void serial_port::wake()
+{
+	if (wake_pipe[1] < 0)
+		return;
+
+	char c = 0;
+	(void)!::write(wake_pipe[1], &c, 1);
+}
+
+std::vector<std::string> serial_port::list()
+{
+	std::vector<std::string> ret;
+	const char *patterns[] = {
+		"/dev/rfcomm*",
+		"/dev/ttyACM*",
+		"/dev/cu.usbmodem*",
+		"/dev/cu.Haptic*"
+	};
+
+	for (const char *pattern : patterns) {
+		glob_t g;
+		if (glob(pattern, 0, nullptr, &g) == 0) {
+			for (size_t i = 0; i < g.gl_pathc; i++)
+				ret.push_back(g.gl_pathv[i]);
+		}
+		globfree(&g);
+	}
+	return ret;
+}
+
+#endif
+
+static int64_t now_ms()
+{
+	using namespace std::chrono;
+	return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool receive_chunks(serial_port &port, std::vector<uint8_t> &data,
+	const std::function<bool(const std::string &)> &line_handler, int timeout_ms)
+{
+	std::string line;
+	size_t chunk = 0;	// raw bytes still to read
+	bool in_chunk = false;
+	int64_t last = now_ms();
+
+	char buffer[1024];
+	while (now_ms() - last < timeout_ms) {
+		long length = port.read(buffer, sizeof(buffer), 100);
+		if (length < 0)
+			return false;
+		if (length > 0)
+			last = now_ms();
+
+		for (long i = 0; i < length; i++) {
+			if (in_chunk) {
+				data.push_back(uint8_t(buffer[i]));
+				if (--chunk == 0)
+					in_chunk = false;
+				continue;
+			}
+
+			if (buffer[i] != '\n') {
+				line.push_back(buffer[i]);
+				continue;
+			}
+
+			unsigned long size = 0;
+			if (std::sscanf(line.c_str(), "B %lu", &size) == 1) {
+				if (size == 0)
+					return true;
+				chunk = size;
+				in_chunk = true;
+			} else if (line_handler && line_handler(line)) {
+				return true;
+			}
+			line.clear();
+		}
+	}
+	return false;
+}
+
+} // namespace haptic
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_HOST_SERIAL_HPP
+#define HAPTIC_BRACELET_HOST_SERIAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace haptic {
+
+/*
+ * serial_port:
+ *
+ * Raw, non-blocking serial port. Not thread safe, owned by one I/O thread.
+ */
+class serial_port {
+public:
+	serial_port();
+	~serial_port();
+
+	serial_port(const serial_port &) = delete;
+	serial_port &operator=(const serial_port &) = delete;
+
+	bool open(const std::string &name);
+	void close();
+	bool is_open() const;
+	const std::string &name() const { return port_name; }
+
+	// false on error, the port should be reopened
+	bool write(const char *data, size_t size);
+
+	/*
+	 * read:
+	 *
+	 * Wait up to timeout_ms for input, or for wake().
+	 * Returns the number of bytes read (0 on timeout), -1 on error.
+	 */
+	long read(char *data, size_t size, int timeout_ms);
+
+	// Cut a read() wait short. Safe from any thread.
+	void wake();
+
+	static std::vector<std::string> list();
+
+private:
+	std::string port_name;
+#if defined(_WIN32)
+	// Overlapped, read() waits on the port's events and wake_event at once
+	void *handle = nullptr;
+	void *wake_event = nullptr;
+	void *comm_event = nullptr;
+	void *io_event = nullptr;
+
+	long read_now(char *data, size_t size);
+#else
+	int fd = -1;
+	int wake_pipe[2] = {-1, -1};
+#endif
+};
+
+/*
+ * receive_chunks:
+ *
+ * The bracelet's downloads: lines, and "B <length>" headers each followed
+ * by that many raw bytes, which are appended to data. Other lines go to
+ * line_handler. Until "B 0", the handler returns true, or nothing arrives
+ * for timeout_ms. False on timeout or a port error.
+ */
+bool receive_chunks(serial_port &port, std::vector<uint8_t> &data,
+	const std::function<bool(const std::string &)> &line_handler, int timeout_ms);
+
+} // namespace haptic
+
+#endif /* HAPTIC_BRACELET_HOST_SERIAL_HPP */
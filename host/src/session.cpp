@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <algorithm>
+
+#include "session.hpp"
+
+namespace haptic {
+
+// One firmware tick, the device only looks at its schedule once per ms
+static constexpr int64_t tick_us = 1000;
+
+// Used until a link has measured its own round trip
+static constexpr int64_t default_rtt_us = 50000;
+
+int32_t session::add(const std::string &port)
+{
+	if (links.size() >= 32)
+		return -1;
+
+	links.push_back(std::make_unique<link>(port));
+	return static_cast<int32_t>(links.size() - 1);
+}
+
+int64_t session::lead_us()
+{
+	// A whole round trip, at p99, is a safe bound on the one way trip
+	int64_t worst = 0;
+	for (auto &l : links) {
+		int64_t rtt = l->rtt_p99_us();
+		worst = std::max(worst, rtt < 0 ? default_rtt_us : rtt);
+	}
+	return worst + tick_us;
+}
+
+int64_t session::pulse(uint32_t mask, uint32_t ms, int64_t lead)
+{
+	if (lead < 0)
+		lead = lead_us();
+
+	int64_t at = now_us() + lead;
+	uint32_t id = next_id++;
+
+	for (size_t i = 0; i < links.size(); i++) {
+		if (!(mask & (1u << i)))
+			continue;
+
+		link &l = *links[i];
+		int64_t device_at = l.device_time_us(at);
+
+		// Not synced (yet, or old firmware): best effort
+		if (device_at < 0)
+			l.pulse(ms);
+		else
+			l.schedule(id, device_at, ms);
+
+		l.flush();
+	}
+	return at;
+}
+
+} // namespace haptic
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_HOST_SESSION_HPP
+#define HAPTIC_BRACELET_HOST_SESSION_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "link.hpp"
+
+namespace haptic {
+
+/*
+ * session:
+ *
+ * Several bracelets, each on its own link (and I/O thread). A pulse sent
+ * to several of them is scheduled at one host instant, translated to each
+ * device clock, so they start together regardless of which link is slower.
+ */
+class session {
+public:
+	int32_t add(const std::string &port);
+	size_t size() const { return links.size(); }
+	link *at(size_t index) { return index < links.size() ? links[index].get() : nullptr; }
+
+	/*
+	 * pulse:
+	 *
+	 * Start ms long pulses on every device in mask, at host time now + lead.
+	 * lead_us < 0 picks the smallest lead every device can meet.
+	 * Returns the host time the pulses were scheduled at.
+	 */
+	int64_t pulse(uint32_t mask, uint32_t ms, int64_t lead_us);
+
+	// The lead pulse() uses when asked to pick one
+	int64_t lead_us();
+
+private:
+	std::vector<std::unique_ptr<link>> links;
+	uint32_t next_id = 1;
+};
+
+} // namespace haptic
+
+#endif /* HAPTIC_BRACELET_HOST_SESSION_HPP */
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_BRACELET_HOST_SPSC_QUEUE_HPP
+#define HAPTIC_BRACELET_HOST_SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace haptic {
+
+/*
+ * spsc_queue:
+ *
+ * Bounded, lock-free, single producer / single consumer. Same shape as the
+ * firmware's command_link_t queue. Holds N - 1 items.
+ */
+template <typename T, size_t N>
+class spsc_queue {
+public:
+	bool push(const T &item)
+	{
+		size_t head = head_index.load(std::memory_order_relaxed);
+		size_t head_next = (head + 1) % N;
+		if (head_next == tail_index.load(std::memory_order_acquire))
+			return false;
+
+		items[head] = item;
+		head_index.store(head_next, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &item)
+	{
+		size_t tail = tail_index.load(std::memory_order_relaxed);
+		if (tail == head_index.load(std::memory_order_acquire))
+			return false;
+
+		item = items[tail];
+		tail_index.store((tail + 1) % N, std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::array<T, N> items;
+	alignas(64) std::atomic<size_t> head_index{0};
+	alignas(64) std::atomic<size_t> tail_index{0};
+};
+
+} // namespace haptic
+
+#endif /* HAPTIC_BRACELET_HOST_SPSC_QUEUE_HPP */
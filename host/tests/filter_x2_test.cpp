@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * filter-x2-test:
+ *
+ * The firmware's two channel filters (src/filter, the plain C lanes the
+ * host builds) against one channel at a time, bit for bit: the median
+ * against two filter_median3_t, the EMA against a lane by lane model of
+ * its fixed point. Random inputs, then the edges (saturation, -32768).
+ * Prints the first mismatch and fails.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "filter.h"
+}
+
+static int failures = 0;
+
+static void check(const char *name, size_t i, uint32_t x, int32_t got, int32_t want, const char *lane)
+{
+	if (got == want)
+		return;
+
+	if (failures++ == 0)
+		std::fprintf(stderr, "%s: sample %zu, input 0x%08" PRIx32 ", %s lane gave %" PRId32 ", expected %" PRId32 "\n",
+			name, i, x, lane, got, want);
+}
+
+static int32_t saturate16(int32_t value)
+{
+	return std::clamp<int32_t>(value, INT16_MIN, INT16_MAX);
+}
+
+// One lane of filter_ema_x2(), as documented
+struct ema_lane {
+	int32_t state;
+	uint8_t shift;
+
+	ema_lane(uint8_t shift, int16_t value) : state(value * (1 << FILTER_EMA_X2_FRACTION)), shift(shift) {}
+
+	int32_t operator()(int16_t x)
+	{
+		int32_t step = saturate16(x * (1 << FILTER_EMA_X2_FRACTION) - state) >> shift;
+		state = saturate16(state + step);
+		return state >> FILTER_EMA_X2_FRACTION;
+	}
+};
+
+static void test_median3(const std::vector<uint32_t> &inputs)
+{
+	struct filter_median3_x2_t both;
+	struct filter_median3_t low, high;
+	filter_median3_x2_init(&both, inputs[0]);
+	filter_median3_init(&low, filter_low(inputs[0]));
+	filter_median3_init(&high, filter_high(inputs[0]));
+
+	for (size_t i = 0; i < inputs.size(); i++) {
+		uint32_t x = inputs[i];
+		uint32_t y = filter_median3_x2(&both, x);
+		check("median3_x2", i, x, filter_low(y),  filter_median3(&low,  filter_low(x)),  "low");
+		check("median3_x2", i, x, filter_high(y), filter_median3(&high, filter_high(x)), "high");
+	}
+}
+
+static void test_ema(const std::vector<uint32_t> &inputs, uint8_t shift)
+{
+	struct filter_ema_x2_t both;
+	filter_ema_x2_init(&both, shift, inputs[0]);
+	ema_lane low(shift, filter_low(inputs[0]));
+	ema_lane high(shift, filter_high(inputs[0]));
+
+	for (size_t i = 0; i < inputs.size(); i++) {
+		uint32_t x = inputs[i];
+		uint32_t y = filter_ema_x2(&both, x);
+		check("ema_x2", i, x, filter_low(y),  low(filter_low(x)),   "low");
+		check("ema_x2", i, x, filter_high(y), high(filter_high(x)), "high");
+	}
+}
+
+// Random values between low and high, then every pair of the edges, in runs
+static std::vector<uint32_t> inputs(int32_t low, int32_t high, std::mt19937 &random)
+{
+	std::uniform_int_distribution<int32_t> any(low, high);
+	std::vector<uint32_t> ret;
+	for (int i = 0; i < 100000; i++)
+		ret.push_back(filter_pack(int16_t(any(random)), int16_t(any(random))));
+
+	const int32_t edges[] = {low, low + 1, -1, 0, 1, high - 1, high};
+	for (int32_t a : edges) {
+		for (int32_t b : edges) {
+			for (int run = 0; run < 40; run++)
+				ret.push_back(filter_pack(int16_t(run & 1 ? a : b), int16_t(run & 1 ? b : a)));
+		}
+	}
+	return ret;
+}
+
+int main()
+{
+	std::mt19937 random(2025);
+
+	// Any 16 bit value
+	test_median3(inputs(INT16_MIN, INT16_MAX, random));
+
+	// Inputs fit in 12 bits, the lanes keep 3 more
+	std::vector<uint32_t> adc = inputs(-4096, 4095, random);
+	for (uint8_t shift = 0; shift <= 8; shift++)
+		test_ema(adc, shift);
+
+	if (failures > 0) {
+		std::fprintf(stderr, "%d mismatches\n", failures);
+		return 1;
+	}
+	std::printf("filter _x2: ok\n");
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * movement-test:
+ *
+ * The firmware's aux knob movement detector (src/movement) on synthetic
+ * traces, one reading per tick around 2048 with uniform noise: still, then
+ * turns that are slow or long enough to drag a noise floor learnt while
+ * moving up to their own slope, and a pot noisy enough that a floor which
+ * can't rise fires all the time. Every turn and every reversal has to fire
+ * within a window of where it starts, and nothing else may fire.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "config.h"
+#include "movement.h"
+}
+
+// Counts per tick, in halves, for as many ticks
+struct segment {
+	int half_slope;
+	int ticks;
+};
+
+struct expected {
+	int direction;
+	int from;	// tick the turn starts
+};
+
+// How late an event may come, in ticks
+#define WINDOW 200
+
+static int failures = 0;
+
+static bool trace(const char *name, int noise, const std::vector<segment> &segments, const std::vector<expected> &events)
+{
+	// Fixed, and the same on every standard library
+	std::mt19937 random(2025);
+
+	struct movement_t movement;
+	movement_init(&movement, 2048);
+
+	std::vector<bool> seen(events.size(), false);
+	bool ok = true;
+	int tick = 0;
+	int halves = 2048 * 2;
+
+	for (const segment &s : segments) {
+		for (int i = 0; i < s.ticks; i++, tick++) {
+			halves += s.half_slope;
+			int32_t value = halves / 2 + int32_t(random() % (2 * noise + 1)) - noise;
+
+			struct movement_event_t event;
+			if (!movement_update(&movement, value, &event))
+				continue;
+
+			bool wanted = false;
+			for (size_t e = 0; e < events.size(); e++) {
+				if (!seen[e] && event.direction == events[e].direction &&
+				    tick >= events[e].from && tick < events[e].from + WINDOW) {
+					seen[e] = true;
+					wanted = true;
+					break;
+				}
+			}
+			if (!wanted) {
+				std::fprintf(stderr, "%s: unexpected %s at tick %d\n", name, event.direction > 0 ? "up" : "down", tick);
+				ok = false;
+			}
+		}
+	}
+
+	for (size_t e = 0; e < events.size(); e++) {
+		if (!seen[e]) {
+			std::fprintf(stderr, "%s: missed %s from tick %d\n", name, events[e].direction > 0 ? "up" : "down",
+				events[e].from);
+			ok = false;
+		}
+	}
+
+	if (!ok)
+		failures++;
+	return ok;
+}
+
+int main()
+{
+	trace("still", 1, {{0, 60000}}, {});
+
+	// 1000 counts at 0.5 per tick, and back
+	trace("slow turn", 1, {{0, 2000}, {1, 2000}, {-1, 2000}, {0, 2000}},
+		{{1, 2000}, {-1, 4000}});
+
+	// 1000 counts at 2 per tick, and back
+	trace("long turn", 1, {{0, 2000}, {4, 500}, {-4, 500}, {0, 2000}},
+		{{1, 2000}, {-1, 2500}});
+
+	// Brief, with still in between
+	trace("short turns", 1, {{0, 2000}, {20, 50}, {0, 1000}, {-20, 50}, {0, 1000}},
+		{{1, 2000}, {-1, 3050}});
+
+	// +-40 counts, 400 count turns in 40 ms
+	trace("noisy still", 40, {{0, 60000}}, {});
+	trace("noisy turns", 40, {{0, 2000}, {20, 40}, {0, 1000}, {-20, 40}, {0, 1000}},
+		{{1, 2000}, {-1, 3040}});
+
+	if (failures > 0) {
+		std::fprintf(stderr, "%d traces failed\n", failures);
+		return 1;
+	}
+	std::printf("movement: ok\n");
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_HOST_SDK_GPIO_H
+#define HAPTIC_HOST_SDK_GPIO_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NUM_BANK0_GPIOS 48
+
+#define GPIO_IN  false
+#define GPIO_OUT true
+
+#define GPIO_FUNC_PWM 4
+
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, int function);
+bool gpio_get(uint gpio);
+uint64_t gpio_get_all64(void);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+/*
+ * sdk_gpio_drive:
+ *
+ * Not the SDK's: move an input pin, and with its interrupt enabled, call
+ * the callback from the calling thread, the "interrupt".
+ */
+void sdk_gpio_drive(uint gpio, bool level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAPTIC_HOST_SDK_GPIO_H */
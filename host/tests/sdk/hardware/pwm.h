@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_HOST_SDK_PWM_H
+#define HAPTIC_HOST_SDK_PWM_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWM_CHAN_A 0
+#define PWM_CHAN_B 1
+
+uint pwm_gpio_to_slice_num(uint gpio);
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_enabled(uint slice, bool enabled);
+void pwm_set_chan_level(uint slice, uint channel, uint16_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAPTIC_HOST_SDK_PWM_H */
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef HAPTIC_HOST_SDK_MALLOC_H
+#define HAPTIC_HOST_SDK_MALLOC_H
+
+#include <stdlib.h>
+
+#endif /* HAPTIC_HOST_SDK_MALLOC_H */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * pico/stdlib.h:
+ *
+ * Just enough of the Pico SDK for host builds of firmware modules, see
+ * sdk.c. Time is the host's, started a little before the 32 bit us wrap.
+ */
+
+#ifndef HAPTIC_HOST_SDK_STDLIB_H
+#define HAPTIC_HOST_SDK_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __unused __attribute__((unused))
+
+absolute_time_t get_absolute_time(void);
+uint64_t time_us_64(void);
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+	return t;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+	return (uint32_t)(t / 1000);
+}
+
+void panic(const char *fmt, ...) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAPTIC_HOST_SDK_STDLIB_H */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "pico/stdlib.h"
+
+#include "config.h"
+#include "config_adv.h"
+#include "trace.h"
+
+// Boot 250 ms before the low 32 bits of the us wrap
+#define SDK_BOOT_US ((1ull << 32) - 250000)
+
+static uint64_t sdk_host_us(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t _Atomic sdk_start;
+
+uint64_t time_us_64(void)
+{
+	uint64_t start = atomic_load_explicit(&sdk_start, memory_order_relaxed);
+	if (start == 0) {
+		uint64_t expected = 0;
+		start = sdk_host_us();
+		if (!atomic_compare_exchange_strong_explicit(&sdk_start, &expected, start,
+				memory_order_relaxed, memory_order_relaxed))
+			start = expected;
+	}
+	return SDK_BOOT_US + (sdk_host_us() - start);
+}
+
+// Where another context gets in, as an interrupt could anywhere: on one
+// host core, threads otherwise only switch at the scheduler's tick
+absolute_time_t get_absolute_time(void)
+{
+	sched_yield();
+	return time_us_64();
+}
+
+void panic(const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+	abort();
+}
+
+static uint64_t _Atomic sdk_levels;
+static uint64_t _Atomic sdk_irq_enabled;
+static gpio_irq_callback_t _Atomic sdk_irq_callback;
+
+void gpio_init(__unused uint gpio) {}
+void gpio_set_dir(__unused uint gpio, __unused bool out) {}
+void gpio_pull_up(__unused uint gpio) {}
+void gpio_set_function(__unused uint gpio, __unused int function) {}
+
+bool gpio_get(uint gpio)
+{
+	return (atomic_load_explicit(&sdk_levels, memory_order_relaxed) >> gpio) & 1;
+}
+
+uint64_t gpio_get_all64(void)
+{
+	return atomic_load_explicit(&sdk_levels, memory_order_relaxed);
+}
+
+void gpio_set_irq_enabled(uint gpio, __unused uint32_t events, bool enabled)
+{
+	if (enabled)
+		atomic_fetch_or_explicit(&sdk_irq_enabled, 1ull << gpio, memory_order_relaxed);
+	else
+		atomic_fetch_and_explicit(&sdk_irq_enabled, ~(1ull << gpio), memory_order_relaxed);
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+	atomic_store_explicit(&sdk_irq_callback, callback, memory_order_release);
+	gpio_set_irq_enabled(gpio, events, enabled);
+}
+
+void sdk_gpio_drive(uint gpio, bool level)
+{
+	uint64_t bit = 1ull << gpio;
+	uint64_t before = level ?
+		atomic_fetch_or_explicit(&sdk_levels, bit, memory_order_relaxed) :
+		atomic_fetch_and_explicit(&sdk_levels, ~bit, memory_order_relaxed);
+	if (((before & bit) != 0) == level)
+		return;
+
+	gpio_irq_callback_t callback = atomic_load_explicit(&sdk_irq_callback, memory_order_acquire);
+	if (callback != NULL && (atomic_load_explicit(&sdk_irq_enabled, memory_order_relaxed) & bit))
+		callback(gpio, level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+}
+
+uint pwm_gpio_to_slice_num(uint gpio)
+{
+	return (gpio >> 1) & 7;
+}
+
+void pwm_set_wrap(__unused uint slice, __unused uint16_t wrap) {}
+void pwm_set_enabled(__unused uint slice, __unused bool enabled) {}
+void pwm_set_chan_level(__unused uint slice, __unused uint channel, __unused uint16_t level) {}
+
+#if TRACE_ENABLED
+// The ring isn't what's tested, and wants the M33's cycle counter
+void trace_add(__unused uint8_t phase, __unused uint8_t id, __unused uint16_t value) {}
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * tick-race-test:
+ *
+ * The firmware's digital and motor modules (src/digital, src/motor) on a
+ * stub SDK (tests/sdk), built with ThreadSanitizer. Three threads stand in
+ * for the contexts that share them on the bracelet:
+ *   irq    the GPIO interrupt, button and fault edges
+ *   timer  the tick: digital_bank_update(), motor_update(), pulses
+ *   main   pulses, motor state, transitions and press times
+ * The clock starts just before the low 32 bits of the us wrap, a torn
+ * 64 bit press time shows as one 2^32 us off. TSan fails the run on a
+ * race, the checks here on a wrong value.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "hardware/gpio.h"
+#include "digital.h"
+#include "motor.h"
+
+#define PIN_BUTTON 5
+#define PIN_HOLD   6
+#define PIN_FAULT  22
+
+static atomic_bool running = true;
+static int failures = 0;
+
+static uint64_t steady_ms(void)
+{
+	struct timespec clock;
+	clock_gettime(CLOCK_MONOTONIC, &clock);
+	return (uint64_t)clock.tv_sec * 1000 + clock.tv_nsec / 1000000;
+}
+
+static void fail(const char *what, uint64_t value, uint64_t low, uint64_t high)
+{
+	if (failures++ == 0)
+		fprintf(stderr, "%s: %" PRIu64 " outside %" PRIu64 "..%" PRIu64 "\n", what, value, low, high);
+}
+
+static void *irq(void *arg)
+{
+	(void)arg;
+	bool level = false;
+	for (unsigned i = 0; atomic_load_explicit(&running, memory_order_relaxed); i++) {
+		level = !level;
+		sdk_gpio_drive(PIN_BUTTON, level);
+		sdk_gpio_drive(PIN_HOLD, (i & 0x3ff) < 0x300);
+		if ((i & 0xfff) == 0)
+			sdk_gpio_drive(PIN_FAULT, level);
+		nanosleep(&(struct timespec){ .tv_nsec = 30000 }, NULL);
+	}
+	return NULL;
+}
+
+static void *timer(void *arg)
+{
+	struct motor_t *motor = arg;
+	while (atomic_load_explicit(&running, memory_order_relaxed)) {
+		digital_bank_update();
+		motor_update(motor);
+		motor_pulse(motor, 1);
+		sched_yield();
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	static struct digital_t button;
+	static struct digital_t hold;
+	static struct motor_t motor;
+
+	digital_init(&button, PIN_BUTTON, low_is_false, DIGITAL_DEBOUNCE_NONE);
+	digital_init(&hold, PIN_HOLD, low_is_false, DIGITAL_DEBOUNCE_LOCKOUT);
+	motor_init(&motor, 20, 21, PIN_FAULT);
+
+	struct motor_parameters_t parameters = {
+		.pwm = 200,
+		.reverse_denominator = 4,
+		.reverse_ms_max = 10,
+		.brake_denominator = 4,
+		.brake_ms_max = 10
+	};
+	motor_set_parameters(&motor, parameters);
+
+	us_t boot = us_now();
+	pthread_t irq_thread, timer_thread;
+	pthread_create(&irq_thread, NULL, irq, NULL);
+	pthread_create(&timer_thread, NULL, timer, &motor);
+
+	us_t pressed = 0;
+	us_t released = 0;
+	unsigned went_true = 0, went_false = 0, busy = 0;
+	uint64_t until = steady_ms() + 600;
+	while (steady_ms() < until) {
+		// Short and often, for both to start one on the same motor_asleep
+		for (int i = 0; i < 64; i++)
+			motor_pulse(&motor, 1);
+		int state = motor_get_state(&motor);
+		if (state < motor_asleep || state > motor_claimed)
+			fail("motor state", state, motor_asleep, motor_claimed);
+		busy += state != motor_asleep;
+
+		went_true  += digital_went_true(&button);
+		went_false += digital_went_false(&button);
+		digital_held_true(&hold, 1000);	// never a second here, the clear races
+
+		// Only ever forward, and never past now
+		us_t pressed_at = digital_pressed_at(&button);
+		us_t released_at = digital_released_at(&button);
+		us_t now = us_now();
+		if (pressed_at < pressed || pressed_at > now)
+			fail("pressed at", pressed_at, pressed, now);
+		if (released_at < released || released_at > now)
+			fail("released at", released_at, released, now);
+		pressed = pressed_at;
+		released = released_at;
+	}
+
+	atomic_store_explicit(&running, false, memory_order_relaxed);
+	pthread_join(irq_thread, NULL);
+	pthread_join(timer_thread, NULL);
+
+	printf("%u went true, %u went false, %u busy, %.3f s from boot, past the wrap: %s\n",
+		went_true, went_false, busy, (us_now() - boot) / 1e6,
+		(boot >> 32) != (pressed >> 32) ? "yes" : "no");
+
+	if (went_true == 0 || went_false == 0 || busy == 0 || (boot >> 32) == (pressed >> 32)) {
+		fprintf(stderr, "too little happened to tell\n");
+		return 1;
+	}
+	return failures != 0;
+}
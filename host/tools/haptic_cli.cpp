@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-cli:
+ *
+ * Send pulses to a bracelet and report link statistics.
+ *
+ *   haptic-cli [-p port]... [-n pulses] [-d ms] [-i interval_ms] [-w seconds]
+ *
+ * Without -n it only pings, which measures the link round trip.
+ * With several -p, pulses go to every device at once, through a session.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "haptic.h"
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s [-p port]... [-n pulses] [-d ms] [-i interval_ms] [-w seconds]\n", name);
+	std::exit(1);
+}
+
+static void print_stats(haptic_link *link)
+{
+	struct haptic_stats stats;
+	haptic_get_stats(link, &stats);
+
+	std::printf("connected %d, reconnects %u\n", stats.connected, stats.reconnects);
+	std::printf("pulses %llu, batches %llu, dropped %llu\n",
+		(unsigned long long)stats.pulses,
+		(unsigned long long)stats.batches,
+		(unsigned long long)stats.dropped);
+
+	if (stats.rtt_samples > 0) {
+		std::printf("rtt us (%u samples): min %.0f, mean %.0f, p50 %.0f, p99 %.0f, max %.0f\n",
+			stats.rtt_samples,
+			stats.rtt_min_us, stats.rtt_mean_us, stats.rtt_p50_us, stats.rtt_p99_us, stats.rtt_max_us);
+	}
+
+	if (stats.clock_synced)
+		std::printf("clock offset %lld us\n", (long long)stats.clock_offset_us);
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<const char *> ports;
+	int pulses = 0;
+	int duration_ms = 30;
+	int interval_ms = 500;
+	int wait_s = 5;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			usage(argv[0]);
+
+		if (std::strcmp(argv[i], "-p") == 0)
+			ports.push_back(argv[++i]);
+		else if (std::strcmp(argv[i], "-n") == 0)
+			pulses = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-d") == 0)
+			duration_ms = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-i") == 0)
+			interval_ms = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-w") == 0)
+			wait_s = std::atoi(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+
+	if (ports.empty())
+		ports.push_back(""); // scan
+
+	haptic_session *session = haptic_session_new();
+	if (session == nullptr)
+		return 1;
+
+	uint32_t mask = 0;
+	for (const char *port : ports)
+		mask |= 1u << haptic_session_add(session, port);
+
+	// Wait for the ports, and a few pings
+	for (size_t i = 0; i < ports.size(); i++) {
+		haptic_link *link = haptic_session_link(session, i);
+		for (int j = 0; j < 100; j++) {
+			struct haptic_stats stats;
+			haptic_get_stats(link, &stats);
+			if (stats.connected && stats.clock_synced)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	for (int i = 0; i < pulses; i++) {
+		if (ports.size() == 1) {
+			haptic_link *link = haptic_session_link(session, 0);
+			haptic_pulse(link, duration_ms);
+			haptic_flush(link);
+		} else {
+			haptic_session_pulse(session, mask, duration_ms, -1);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+	}
+
+	std::this_thread::sleep_for(std::chrono::seconds(wait_s));
+	for (size_t i = 0; i < ports.size(); i++) {
+		std::printf("device %zu\n", i);
+		print_stats(haptic_session_link(session, i));
+	}
+
+	haptic_session_free(session);
+	return 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-detok:
+ *
+ * Tokenized LOG() lines (firmware built with LOG_TOKENIZED) back to text.
+ *
+ *   haptic-detok -g database file.c...     build the database
+ *   haptic-detok -d database [-p port]     decode a port, or stdin
+ *
+ * The database has one "<token hex>\t<format, C escaped>" line per LOG()
+ * format found in the sources. Other lines pass through as they are.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "serial.hpp"
+
+// Same as LOG_TOKEN() in firmware/src/log/log_token.h
+static constexpr uint32_t token_k      = 65599;
+static constexpr size_t   token_length = 64;
+
+static uint32_t token(const std::string &format)
+{
+	uint32_t hash = static_cast<uint32_t>(format.size());
+	uint32_t coefficient = token_k;
+	for (size_t i = 0; i < format.size() && i < token_length; i++) {
+		hash += coefficient * static_cast<uint8_t>(format[i]);
+		coefficient *= token_k;
+	}
+	return hash;
+}
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s -g database file.c...\n", name);
+	std::fprintf(stderr, "       %s -d database [-p port]\n", name);
+	std::exit(1);
+}
+
+/*
+ * Database
+ */
+
+// <inttypes.h> macros as newlib defines them for the RP2350
+static const std::map<std::string, std::string> format_macros = {
+	{"PRId8", "d"}, {"PRIu8", "u"}, {"PRIx8", "x"},
+	{"PRId16", "d"}, {"PRIu16", "u"}, {"PRIx16", "x"},
+	{"PRId32", "ld"}, {"PRIu32", "lu"}, {"PRIx32", "lx"}, {"PRIX32", "lX"},
+};
+
+static std::string escape(const std::string &text)
+{
+	std::string ret;
+	for (char c : text) {
+		switch (c) {
+			case '\n': ret += "\\n"; break;
+			case '\r': ret += "\\r"; break;
+			case '\t': ret += "\\t"; break;
+			case '\\': ret += "\\\\"; break;
+			default:   ret += c; break;
+		}
+	}
+	return ret;
+}
+
+static std::string unescape(const std::string &text)
+{
+	std::string ret;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] != '\\' || i + 1 >= text.size()) {
+			ret += text[i];
+			continue;
+		}
+		switch (text[++i]) {
+			case 'n': ret += '\n'; break;
+			case 'r': ret += '\r'; break;
+			case 't': ret += '\t'; break;
+			case '0': ret += '\0'; break;
+			default:  ret += text[i]; break;
+		}
+	}
+	return ret;
+}
+
+// String literals and PRI macros from text[i], up to the ',' or ')'
+static bool parse_format(const std::string &text, size_t i, std::string &format)
+{
+	bool found = false;
+	while (i < text.size()) {
+		char c = text[i];
+		if (std::isspace(static_cast<unsigned char>(c))) {
+			i++;
+		} else if (c == '"') {
+			for (i++; i < text.size() && text[i] != '"'; i++) {
+				if (text[i] == '\\' && i + 1 < text.size()) {
+					format += unescape(text.substr(i, 2));
+					i++;
+				} else {
+					format += text[i];
+				}
+			}
+			i++;
+			found = true;
+		} else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+			size_t end = i;
+			while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_'))
+				end++;
+			auto macro = format_macros.find(text.substr(i, end - i));
+			if (macro == format_macros.end())
+				return false;
+			format += macro->second;
+			i = end;
+		} else {
+			return found && (c == ',' || c == ')');
+		}
+	}
+	return false;
+}
+
+static int generate(const char *path, int count, char **files)
+{
+	std::map<uint32_t, std::string> database;
+
+	for (int f = 0; f < count; f++) {
+		std::ifstream in(files[f]);
+		std::stringstream buffer;
+		buffer << in.rdbuf();
+		std::string text = buffer.str();
+
+		for (size_t i = text.find("LOG("); i != std::string::npos; i = text.find("LOG(", i + 4)) {
+			// Not part of a longer name
+			if (i > 0 && (std::isalnum(static_cast<unsigned char>(text[i - 1])) || text[i - 1] == '_'))
+				continue;
+
+			std::string format;
+			if (!parse_format(text, i + 4, format))
+				continue;
+
+			uint32_t t = token(format);
+			auto it = database.find(t);
+			if (it != database.end() && it->second != format)
+				std::fprintf(stderr, "%s: token collision %08" PRIx32 "\n", files[f], t);
+			database[t] = format;
+		}
+	}
+
+	FILE *out = std::fopen(path, "w");
+	if (out == nullptr) {
+		std::perror(path);
+		return 1;
+	}
+	for (auto &entry : database)
+		std::fprintf(out, "%08" PRIx32 "\t%s\n", entry.first, escape(entry.second).c_str());
+	std::fclose(out);
+	return 0;
+}
+
+static bool load(const char *path, std::map<uint32_t, std::string> &database)
+{
+	std::ifstream in(path);
+	if (!in)
+		return false;
+
+	std::string line;
+	while (std::getline(in, line)) {
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos)
+			continue;
+		uint32_t t = static_cast<uint32_t>(std::strtoul(line.substr(0, tab).c_str(), nullptr, 16));
+		database[t] = unescape(line.substr(tab + 1));
+	}
+	return true;
+}
+
+/*
+ * Decoding
+ */
+
+static bool base64(const std::string &text, std::vector<uint8_t> &out)
+{
+	static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	uint32_t group = 0;
+	int bits = 0;
+	for (char c : text) {
+		if (c == '=')
+			break;
+		size_t value = alphabet.find(c);
+		if (value == std::string::npos)
+			return false;
+		group = (group << 6) | static_cast<uint32_t>(value);
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			out.push_back(static_cast<uint8_t>(group >> bits));
+		}
+	}
+	return true;
+}
+
+static bool varint(const std::vector<uint8_t> &data, size_t &i, uint32_t &value)
+{
+	value = 0;
+	for (int shift = 0; i < data.size() && shift < 35; shift += 7) {
+		uint8_t byte = data[i++];
+		value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// printf() with the device's 32 bit arguments
+static std::string format_args(const std::string &format, const std::vector<uint32_t> &args)
+{
+	std::string ret;
+	size_t next = 0;
+
+	for (size_t i = 0; i < format.size(); i++) {
+		if (format[i] != '%') {
+			ret += format[i];
+			continue;
+		}
+
+		size_t start = i++;
+		while (i < format.size() && std::strchr("-+ #0123456789.", format[i]))
+			i++;
+		std::string spec = format.substr(start, i - start);
+		while (i < format.size() && std::strchr("hlzjt", format[i]))
+			i++;
+		if (i >= format.size())
+			break;
+
+		char conversion = format[i];
+		if (conversion == '%') {
+			ret += '%';
+			continue;
+		}
+
+		uint32_t arg = next < args.size() ? args[next] : 0;
+		next++;
+
+		char buffer[64];
+		switch (conversion) {
+			case 'd':
+			case 'i':
+				spec += "lld";
+				std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<long long>(static_cast<int32_t>(arg)));
+				break;
+			case 'c':
+				spec += 'c';
+				std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<int>(arg));
+				break;
+			case 'u':
+			case 'x':
+			case 'X':
+			case 'o':
+				spec += "ll";
+				spec += conversion;
+				std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<unsigned long long>(arg));
+				break;
+			default:
+				std::snprintf(buffer, sizeof(buffer), "<%%%c?>", conversion);
+				break;
+		}
+		ret += buffer;
+	}
+	return ret;
+}
+
+static std::string decode(const std::string &line, const std::map<uint32_t, std::string> &database)
+{
+	std::vector<uint8_t> data;
+	if (!base64(line.substr(1), data) || data.size() < 4)
+		return line + "\n";
+
+	uint32_t t = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	size_t i = 4;
+	uint32_t us = 0;
+	varint(data, i, us);
+
+	std::vector<uint32_t> args;
+	uint32_t arg;
+	while (i < data.size() && varint(data, i, arg))
+		args.push_back(arg);
+
+	char prefix[32];
+	std::snprintf(prefix, sizeof(prefix), "[%8" PRIu32 ".%03" PRIu32 "] ", us / 1000, us % 1000);
+
+	auto it = database.find(t);
+	if (it == database.end()) {
+		char unknown[64];
+		std::snprintf(unknown, sizeof(unknown), "<unknown token %08" PRIx32 ", %zu args>\n", t, args.size());
+		return prefix + std::string(unknown);
+	}
+	return prefix + format_args(it->second, args);
+}
+
+static void decode_line(const std::string &line, const std::map<uint32_t, std::string> &database)
+{
+	if (!line.empty() && line[0] == '$')
+		std::fputs(decode(line, database).c_str(), stdout);
+	else
+		std::printf("%s\n", line.c_str());
+	std::fflush(stdout);
+}
+
+static int run(const char *path, const char *port_name)
+{
+	std::map<uint32_t, std::string> database;
+	if (!load(path, database)) {
+		std::perror(path);
+		return 1;
+	}
+
+	if (port_name == nullptr) {
+		std::string line;
+		while (std::getline(std::cin, line))
+			decode_line(line, database);
+		return 0;
+	}
+
+	haptic::serial_port port;
+	if (!port.open(port_name)) {
+		std::fprintf(stderr, "can't open %s\n", port_name);
+		return 1;
+	}
+
+	std::string line;
+	char buffer[256];
+	while (true) {
+		long length = port.read(buffer, sizeof(buffer), 1000);
+		if (length < 0)
+			return 1;
+
+		for (long i = 0; i < length; i++) {
+			if (buffer[i] == '\r')
+				continue;
+			if (buffer[i] != '\n') {
+				line += buffer[i];
+				continue;
+			}
+			decode_line(line, database);
+			line.clear();
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && std::strcmp(argv[1], "-g") == 0)
+		return generate(argv[2], argc - 3, argv + 3);
+
+	if (argc >= 3 && std::strcmp(argv[1], "-d") == 0) {
+		const char *port = nullptr;
+		if (argc == 5 && std::strcmp(argv[3], "-p") == 0)
+			port = argv[4];
+		else if (argc != 3)
+			usage(argv[0]);
+		return run(argv[2], port);
+	}
+
+	usage(argv[0]);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-log:
+ *
+ * Download the bracelet's event log ("l d"), over USB or RFCOMM.
+ *
+ *   haptic-log -p port [-o file.bin] [-c file.csv] [-e] [-s]
+ *
+ * -o keeps the raw records, -c decodes them to CSV (device us, type,
+ * source, value). -s only prints the status line, -e erases the log after
+ * a successful download (or right away, with nothing to download).
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "serial.hpp"
+
+static int64_t now_ms()
+{
+	using namespace std::chrono;
+	return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s -p port [-o file.bin] [-c file.csv] [-e] [-s]\n", name);
+	std::exit(1);
+}
+
+// Same values as enum eventlog_type in the firmware
+static const char *type_name(uint8_t type)
+{
+	switch (type) {
+		case 1: return "time";
+		case 2: return "boot";
+		case 3: return "command";
+		case 4: return "scheduled";
+		case 5: return "pulse";
+		case 6: return "aux_down";
+		case 7: return "aux_up";
+		case 8: return "aux_move";
+		case 9: return "aux_click";
+		case 10: return "aux_wall";
+		case 11: return "aux_gesture";
+		default: return "unknown";
+	}
+}
+
+static const char *source_name(uint8_t source)
+{
+	switch (source) {
+		case 0: return "device";
+		case 1: return "bluetooth";
+		case 2: return "usb";
+		default: return "unknown";
+	}
+}
+
+static bool write_csv(const char *path, const std::vector<uint8_t> &log)
+{
+	FILE *file = std::fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "us,type,source,value\n");
+	uint64_t high = 0;
+	for (size_t i = 0; i + 8 <= log.size(); i += 8) {
+		const uint8_t *r = &log[i];
+		uint32_t us     = r[0] | (r[1] << 8) | (r[2] << 16) | (uint32_t(r[3]) << 24);
+		uint8_t  type   = r[4];
+		uint8_t  source = r[5];
+		uint16_t value  = r[6] | (r[7] << 8);
+
+		if (type == 0xff)
+			continue; // unwritten
+		if (type == 1) {
+			high = uint64_t(us) << 32;
+			continue;
+		}
+		std::fprintf(file, "%" PRIu64 ",%s,%s,%u\n", high | us, type_name(type), source_name(source), value);
+	}
+	std::fclose(file);
+	return true;
+}
+
+static void print_status(haptic::serial_port &port)
+{
+	port.write("l s\n", 4);
+
+	std::string line;
+	char buffer[256];
+	int64_t until = now_ms() + 2000;
+	while (now_ms() < until) {
+		long length = port.read(buffer, sizeof(buffer), 100);
+		for (long i = 0; i < length; i++) {
+			if (buffer[i] != '\n') {
+				line.push_back(buffer[i]);
+				continue;
+			}
+
+			unsigned long size, capacity, dropped;
+			if (std::sscanf(line.c_str(), "L %lu %lu %lu", &size, &capacity, &dropped) == 3) {
+				std::printf("%lu of %lu bytes (%lu records), %lu dropped\n", size, capacity, size / 8, dropped);
+				return;
+			}
+			line.clear();
+		}
+	}
+	std::fprintf(stderr, "no status\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *port_name = nullptr;
+	const char *raw_path = nullptr;
+	const char *csv_path = nullptr;
+	bool erase = false;
+	bool status = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-e") == 0) {
+			erase = true;
+		} else if (std::strcmp(argv[i], "-s") == 0) {
+			status = true;
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-p") == 0) {
+			port_name = argv[++i];
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-o") == 0) {
+			raw_path = argv[++i];
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-c") == 0) {
+			csv_path = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (port_name == nullptr)
+		usage(argv[0]);
+
+	haptic::serial_port port;
+	if (!port.open(port_name)) {
+		std::fprintf(stderr, "can't open %s\n", port_name);
+		return 1;
+	}
+
+	if (status) {
+		print_status(port);
+		return 0;
+	}
+
+	if (raw_path != nullptr || csv_path != nullptr) {
+		std::vector<uint8_t> log;
+		port.write("l d\n", 4);
+		if (!haptic::receive_chunks(port, log, nullptr, 5000)) {
+			std::fprintf(stderr, "timed out\n");
+			return 1;
+		}
+		std::fprintf(stderr, "%zu records\n", log.size() / 8);
+
+		if (raw_path != nullptr) {
+			FILE *file = std::fopen(raw_path, "wb");
+			if (file == nullptr || std::fwrite(log.data(), 1, log.size(), file) != log.size()) {
+				std::perror(raw_path);
+				return 1;
+			}
+			std::fclose(file);
+		}
+
+		if (csv_path != nullptr && !write_csv(csv_path, log)) {
+			std::perror(csv_path);
+			return 1;
+		}
+	}
+
+	if (erase)
+		port.write("l e\n", 4);
+
+	return 0;
+}
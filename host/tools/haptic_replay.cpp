@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-replay:
+ *
+ * Run the firmware's aux knob movement detector (src/movement) on recorded
+ * readings, one per tick, to see what it fires on.
+ *
+ *   haptic-replay [-c column] [-q] file...
+ *
+ * Files have one reading per line, or CSV with the reading in column
+ * (from 0). Lines that don't start with a number are skipped. Prints every
+ * event, then per file the count, events per minute and the noise floor
+ * it settled on. On a trace of a knob left alone, every event is a false
+ * positive. -q only prints the summary.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+extern "C" {
+#include "config.h"
+#include "movement.h"
+}
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s [-c column] [-q] file...\n", name);
+	std::exit(1);
+}
+
+static bool reading(const std::string &line, int column, int32_t &value)
+{
+	std::stringstream stream(line);
+	std::string field;
+	for (int i = 0; i <= column; i++) {
+		if (!std::getline(stream, field, ','))
+			return false;
+	}
+
+	char *end;
+	long tmp = std::strtol(field.c_str(), &end, 10);
+	if (end == field.c_str())
+		return false;
+	value = int32_t(tmp);
+	return true;
+}
+
+static bool replay(const char *path, int column, bool quiet)
+{
+	std::ifstream in(path);
+	if (!in)
+		return false;
+
+	struct movement_t movement;
+	bool started = false;
+	unsigned long ticks = 0;
+	unsigned long events = 0;
+
+	std::string line;
+	while (std::getline(in, line)) {
+		int32_t value;
+		if (!reading(line, column, value))
+			continue;
+
+		if (!started) {
+			movement_init(&movement, value);
+			started = true;
+		}
+
+		struct movement_event_t event;
+		if (movement_update(&movement, value, &event)) {
+			events++;
+			if (!quiet)
+				std::printf("%s: tick %lu %s %u counts, began %u ticks before\n", path, ticks,
+					event.direction > 0 ? "up" : "down", event.magnitude, event.onset);
+		}
+		ticks++;
+	}
+
+	double minutes = ticks * (TICK_PERIOD_US / 1e6) / 60;
+	std::printf("%s: %lu readings, %lu events, %.2f per minute, noise floor %.2f counts\n", path, ticks, events,
+		minutes > 0 ? events / minutes : 0.0, started ? movement_noise(&movement) / 16.0 : 0.0);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int column = 0;
+	bool quiet = false;
+	int files = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-q") == 0) {
+			quiet = true;
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-c") == 0) {
+			column = std::atoi(argv[++i]);
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+		} else {
+			if (!replay(argv[i], column, quiet))
+				std::perror(argv[i]);
+			files++;
+		}
+	}
+
+	if (files == 0)
+		usage(argv[0]);
+	return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-sim:
+ *
+ * Simulated bracelets on local ptys, for exercising the host library
+ * without hardware.
+ *
+ *   haptic-sim [-n devices] [-l latency_us[,latency_us...]] [-j jitter_us] [-t seconds]
+ *
+ * Each device has its own clock offset and one way latency (plus random
+ * jitter), answers pings and runs pulses on a 1 ms tick like the firmware.
+ * Pulses scheduled with the same id on several devices are reported with
+ * the skew between their start times.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int64_t now_us()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct message {
+	int64_t due;	// host time
+	std::string line;
+};
+
+struct scheduled {
+	uint32_t id;
+	int64_t at;	// device time
+	uint32_t ms;
+};
+
+struct device {
+	int fd;
+	std::string path;
+	int64_t offset;		// device clock minus host clock
+	int64_t latency;	// one way
+	std::string input;
+	std::vector<message> inbox;
+	std::vector<message> outbox;
+	std::vector<scheduled> schedule;
+	std::vector<uint32_t> queue;
+	int64_t next_tick;
+	int64_t busy_until;
+};
+
+static std::mt19937 rng(1);
+static int64_t jitter_us = 0;
+
+static int64_t delay(const device &d)
+{
+	if (jitter_us == 0)
+		return d.latency;
+
+	std::uniform_int_distribution<int64_t> dist(0, jitter_us);
+	return d.latency + dist(rng);
+}
+
+static bool open_device(device &d)
+{
+	d.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (d.fd < 0 || grantpt(d.fd) != 0 || unlockpt(d.fd) != 0)
+		return false;
+
+	struct termios tty;
+	tcgetattr(d.fd, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(d.fd, TCSANOW, &tty);
+
+	d.path = ptsname(d.fd);
+	return true;
+}
+
+// The pulse record: id -> start times (host clock) of each device
+static std::map<uint32_t, std::vector<int64_t>> started;
+
+static void handle_line(device &d, size_t index, const std::string &line, int64_t now)
+{
+	int64_t device_now = now + d.offset;
+	std::istringstream in(line);
+
+	if (line[0] == 'p') {
+		std::string cmd, token;
+		in >> cmd >> token;
+		message reply;
+		reply.due = now + delay(d);
+		reply.line = "P " + token + " " + std::to_string(device_now) + "\n";
+		d.outbox.push_back(reply);
+		return;
+	}
+
+	if (line[0] == 's') {
+		std::string cmd;
+		scheduled s;
+		int64_t at;
+		in >> cmd >> s.id >> at >> s.ms;
+		s.at = at;
+		if (s.at < device_now)
+			std::printf("device %zu: pulse %u arrived %" PRId64 " us late\n", index, s.id, device_now - s.at);
+		d.schedule.push_back(s);
+		return;
+	}
+
+	uint32_t ms;
+	while (in >> ms) {
+		if (ms != 0)
+			d.queue.push_back(ms);
+	}
+}
+
+static void tick(device &d, size_t index, int64_t now)
+{
+	int64_t device_now = now + d.offset;
+	if (now < d.busy_until)
+		return;
+
+	for (auto it = d.schedule.begin(); it != d.schedule.end(); it++) {
+		if (it->at > device_now)
+			continue;
+
+		started[it->id].push_back(now);
+		d.busy_until = now + it->ms * 1000;
+		std::printf("device %zu: pulse %u (%u ms) at %" PRId64 "\n", index, it->id, it->ms, device_now);
+		d.schedule.erase(it);
+		return;
+	}
+
+	if (!d.queue.empty()) {
+		d.busy_until = now + d.queue.front() * 1000;
+		std::printf("device %zu: pulse (%u ms) at %" PRId64 "\n", index, d.queue.front(), device_now);
+		d.queue.erase(d.queue.begin());
+	}
+}
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s [-n devices] [-l latency_us[,latency_us...]] [-j jitter_us] [-t seconds]\n", name);
+	std::exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = 2;
+	std::vector<int64_t> latencies = {5000};
+	int seconds = 60;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			usage(argv[0]);
+
+		if (std::strcmp(argv[i], "-n") == 0) {
+			count = std::strtoul(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "-l") == 0) {
+			latencies.clear();
+			std::stringstream list(argv[++i]);
+			std::string item;
+			while (std::getline(list, item, ','))
+				latencies.push_back(std::strtoll(item.c_str(), nullptr, 10));
+		} else if (std::strcmp(argv[i], "-j") == 0) {
+			jitter_us = std::strtoll(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "-t") == 0) {
+			seconds = std::atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (count == 0 || latencies.empty())
+		usage(argv[0]);
+
+	std::vector<device> devices(count);
+	std::uniform_int_distribution<int64_t> offsets(0, 1000000000);
+	int64_t start = now_us();
+	for (size_t i = 0; i < count; i++) {
+		device &d = devices[i];
+		if (!open_device(d)) {
+			std::perror("posix_openpt");
+			return 1;
+		}
+		d.offset  = offsets(rng) - start;
+		d.latency = latencies[std::min(i, latencies.size() - 1)];
+		// Tick phase differs per device, like real hardware
+		d.next_tick = start + offsets(rng) % 1000;
+		d.busy_until = 0;
+		std::printf("device %zu: %s, latency %" PRId64 " us\n", i, d.path.c_str(), d.latency);
+	}
+	std::fflush(stdout);
+
+	int64_t end = start + int64_t(seconds) * 1000000;
+	std::vector<struct pollfd> pfd(count);
+	while (now_us() < end) {
+		for (size_t i = 0; i < count; i++)
+			pfd[i] = {devices[i].fd, POLLIN, 0};
+
+		poll(pfd.data(), pfd.size(), 0);
+		usleep(100);
+		int64_t now = now_us();
+
+		for (size_t i = 0; i < count; i++) {
+			device &d = devices[i];
+
+			char buffer[256];
+			ssize_t length = read(d.fd, buffer, sizeof(buffer));
+			for (ssize_t j = 0; j < length; j++) {
+				if (buffer[j] != '\n' && buffer[j] != '\r') {
+					d.input.push_back(buffer[j]);
+					continue;
+				}
+				if (!d.input.empty())
+					d.inbox.push_back({now + delay(d), d.input});
+				d.input.clear();
+			}
+
+			for (auto it = d.inbox.begin(); it != d.inbox.end();) {
+				if (it->due > now) {
+					it++;
+					continue;
+				}
+				handle_line(d, i, it->line, now);
+				it = d.inbox.erase(it);
+			}
+
+			for (auto it = d.outbox.begin(); it != d.outbox.end();) {
+				if (it->due > now) {
+					it++;
+					continue;
+				}
+				(void)!write(d.fd, it->line.data(), it->line.size());
+				it = d.outbox.erase(it);
+			}
+
+			while (d.next_tick <= now) {
+				tick(d, i, now);
+				d.next_tick += 1000;
+			}
+		}
+		std::fflush(stdout);
+	}
+
+	int64_t worst = 0;
+	size_t pulses = 0;
+	for (auto &entry : started) {
+		if (entry.second.size() < 2)
+			continue;
+
+		auto minmax = std::minmax_element(entry.second.begin(), entry.second.end());
+		int64_t skew = *minmax.second - *minmax.first;
+		worst = std::max(worst, skew);
+		pulses++;
+		std::printf("pulse %u: skew %" PRId64 " us\n", entry.first, skew);
+	}
+	std::printf("%zu synchronised pulses, worst skew %" PRId64 " us\n", pulses, worst);
+
+	for (device &d : devices)
+		close(d.fd);
+	return 0;
+}
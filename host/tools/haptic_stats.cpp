@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-stats:
+ *
+ * Print the bracelet's counters ("k") and timer callback timing ("t").
+ *
+ *   haptic-stats -p port [-t] [-r]
+ *
+ * -t adds the timing histograms, -r resets them afterwards.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "serial.hpp"
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s -p port [-t] [-r]\n", name);
+	std::exit(1);
+}
+
+static bool print_counters(haptic::serial_port &port)
+{
+	// Names first, the snapshot is only numbers
+	std::map<unsigned, std::string> names;
+	std::vector<uint8_t> unused;
+	port.write("k n\n", 4);
+	haptic::receive_chunks(port, unused, [&](const std::string &line) {
+		unsigned index;
+		char name[64];
+		if (std::sscanf(line.c_str(), "K %u %63s", &index, name) == 2)
+			names[index] = name;
+		return line == "K";
+	}, 2000);
+
+	std::vector<uint8_t> snapshot;
+	port.write("k\n", 2);
+	if (!haptic::receive_chunks(port, snapshot, nullptr, 2000) || snapshot.size() < 2) {
+		std::fprintf(stderr, "no counters\n");
+		return false;
+	}
+
+	size_t count = snapshot[0] | (snapshot[1] << 8);
+	for (size_t i = 0; i < count && 2 + 4 * i + 4 <= snapshot.size(); i++) {
+		const uint8_t *p = &snapshot[2 + 4 * i];
+		uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+
+		auto name = names.find(unsigned(i));
+		std::printf("%-24s %10" PRIu32 "\n", name != names.end() ? name->second.c_str() : "?", value);
+	}
+	return true;
+}
+
+static void print_timing(haptic::serial_port &port)
+{
+	std::printf("\n%-8s %10s %6s %6s %9s %6s  histogram (us, power of two buckets)\n",
+		"section", "count", "min", "max", "overruns", "shed");
+
+	std::vector<uint8_t> unused;
+	port.write("t\n", 2);
+	haptic::receive_chunks(port, unused, [](const std::string &line) {
+		if (line == "T")
+			return true;
+		if (line.rfind("T ", 0) != 0)
+			return false;
+
+		char name[32];
+		unsigned long count, min, max, overruns, shed;
+		int used = 0;
+		if (std::sscanf(line.c_str(), "T %31s %lu %lu %lu %lu %lu%n", name, &count, &min, &max, &overruns, &shed, &used) != 6)
+			return false;
+
+		std::printf("%-8s %10lu %6lu %6lu %9lu %6lu ", name, count, min, max, overruns, shed);
+
+		// "<bucket upper bound>:<count>" for the ones in use
+		const char *p = line.c_str() + used;
+		unsigned long bucket_count;
+		int n;
+		for (int bucket = 0; std::sscanf(p, " %lu%n", &bucket_count, &n) == 1; bucket++, p += n) {
+			if (bucket_count != 0)
+				std::printf(" <%lu:%lu", 1ul << bucket, bucket_count);
+		}
+		std::printf("\n");
+		return false;
+	}, 2000);
+}
+
+int main(int argc, char **argv)
+{
+	const char *port_name = nullptr;
+	bool timing = false;
+	bool reset = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-t") == 0) {
+			timing = true;
+		} else if (std::strcmp(argv[i], "-r") == 0) {
+			reset = true;
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-p") == 0) {
+			port_name = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (port_name == nullptr)
+		usage(argv[0]);
+
+	haptic::serial_port port;
+	if (!port.open(port_name)) {
+		std::fprintf(stderr, "can't open %s\n", port_name);
+		return 1;
+	}
+
+	if (!print_counters(port))
+		return 1;
+
+	if (timing)
+		print_timing(port);
+
+	if (reset)
+		port.write("t r\n", 4);
+
+	return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2025 Pierro Zachareas
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * haptic-trace:
+ *
+ * Download the bracelet's trace ring ("r d") and write it as a Chrome
+ * trace, for chrome://tracing or ui.perfetto.dev.
+ *
+ *   haptic-trace -p port [-o file.bin] [-j file.json] [-c]
+ *   haptic-trace -i file.bin -j file.json
+ *
+ * -o keeps the raw dump, -i converts one kept earlier. -c clears the ring
+ * after the download. Timestamps are device us (us_now()), the same clock
+ * as the event log and the pulse acks.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "serial.hpp"
+
+static void usage(const char *name)
+{
+	std::fprintf(stderr, "usage: %s -p port [-o file.bin] [-j file.json] [-c]\n", name);
+	std::fprintf(stderr, "       %s -i file.bin -j file.json\n", name);
+	std::exit(1);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+// Same values as the firmware's trace.h and timing.h
+enum phase { phase_begin = 1, phase_end = 2, phase_instant = 3 };
+enum id {
+	id_tick    = 1,
+	id_task    = 2,
+	id_packet  = 3,
+	id_service = 4,
+	id_motor   = 5,
+	id_enqueue = 6,
+	id_dequeue = 7
+};
+
+static const char *section_name(uint16_t section)
+{
+	static const char *names[] = {"tick", "jitter", "led", "inputs", "motor", "aux", "pulse"};
+	if (section < sizeof(names) / sizeof(names[0]))
+		return names[section];
+	return "task";
+}
+
+static const char *motor_name(uint16_t state)
+{
+	switch (state) {
+		case 0: return "asleep";
+		case 1: return "forward";
+		case 2: return "reverse";
+		case 3: return "brake";
+		default: return "unknown";
+	}
+}
+
+// Chrome trace threads, one per context
+static int thread_of(uint8_t id)
+{
+	switch (id) {
+		case id_tick:
+		case id_task:    return 1;
+		case id_packet:  return 2;
+		case id_service: return 3;
+		case id_motor:   return 4;
+		default:         return 5;
+	}
+}
+
+static std::string event_name(uint8_t id, uint16_t value)
+{
+	char buffer[64];
+	switch (id) {
+		case id_tick:    return "timer_callback";
+		case id_task:    return section_name(value);
+		case id_service: return "service";
+		case id_motor:   return "motor";
+		case id_packet:
+			if ((value >> 8) == 0x04)
+				std::snprintf(buffer, sizeof(buffer), "hci event 0x%02x", value & 0xff);
+			else
+				std::snprintf(buffer, sizeof(buffer), "packet type %u", value >> 8);
+			return buffer;
+		case id_enqueue:
+			std::snprintf(buffer, sizeof(buffer), "enqueue %u ms", value);
+			return buffer;
+		case id_dequeue:
+			std::snprintf(buffer, sizeof(buffer), "dequeue %u ms", value);
+			return buffer;
+		default:
+			std::snprintf(buffer, sizeof(buffer), "id %u", id);
+			return buffer;
+	}
+}
+
+static bool write_json(const char *path, const std::vector<uint8_t> &dump)
+{
+	if (dump.size() < 16) {
+		std::fprintf(stderr, "dump too short\n");
+		return false;
+	}
+
+	uint32_t hz     = get32(&dump[0]);
+	uint32_t cycles = get32(&dump[4]);
+	uint64_t us     = get32(&dump[8]) | (uint64_t(get32(&dump[12])) << 32);
+	if (hz == 0) {
+		std::fprintf(stderr, "no clock in the dump\n");
+		return false;
+	}
+
+	// Unwrap the 32 bit cycle counter, records are in order give or take a preemption
+	size_t count = (dump.size() - 16) / 8;
+	std::vector<int64_t> unwrapped(count);
+	int64_t total = 0;
+	uint32_t prev = count > 0 ? get32(&dump[16]) : cycles;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t c = get32(&dump[16 + i * 8]);
+		total += int32_t(c - prev);
+		unwrapped[i] = total;
+		prev = c;
+	}
+	int64_t end = total + int32_t(cycles - prev);
+
+	FILE *file = std::fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	const char *thread_names[] = {"", "timer callback", "bluetooth", "service", "motor", "commands"};
+	for (int tid = 1; tid <= 5; tid++)
+		std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+			tid, thread_names[tid]);
+
+	for (size_t i = 0; i < count; i++) {
+		const uint8_t *r = &dump[16 + i * 8];
+		uint8_t  phase = r[4];
+		uint8_t  id    = r[5];
+		uint16_t value = r[6] | (r[7] << 8);
+
+		double ts = double(us) - double(end - unwrapped[i]) * 1e6 / hz;
+		int tid = thread_of(id);
+
+		if (id == id_motor) {
+			std::fprintf(file, "{\"name\":\"motor\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"state\":%u}},\n",
+				ts, tid, value);
+			std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n",
+				motor_name(value), ts, tid);
+			continue;
+		}
+
+		const char *ph = "i";
+		if (phase == phase_begin)
+			ph = "B";
+		else if (phase == phase_end)
+			ph = "E";
+
+		std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n",
+			event_name(id, value).c_str(), ph, (phase == phase_instant) ? "\"s\":\"t\"," : "", ts, tid);
+	}
+
+	// The last entry can't have a trailing comma
+	std::fprintf(file, "{\"name\":\"dump\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":1}\n]}\n", us);
+	std::fclose(file);
+
+	std::fprintf(stderr, "%zu records, %.3f ms\n", count, count > 0 ? double(end - unwrapped[0]) * 1e3 / hz : 0.0);
+	return true;
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &dump)
+{
+	FILE *file = std::fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	uint8_t buffer[4096];
+	size_t length;
+	while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		dump.insert(dump.end(), buffer, buffer + length);
+	std::fclose(file);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *port_name = nullptr;
+	const char *input_path = nullptr;
+	const char *raw_path = nullptr;
+	const char *json_path = nullptr;
+	bool clear = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-c") == 0) {
+			clear = true;
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-p") == 0) {
+			port_name = argv[++i];
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-i") == 0) {
+			input_path = argv[++i];
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-o") == 0) {
+			raw_path = argv[++i];
+		} else if (i + 1 < argc && std::strcmp(argv[i], "-j") == 0) {
+			json_path = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	std::vector<uint8_t> dump;
+
+	if (input_path != nullptr) {
+		if (port_name != nullptr || json_path == nullptr)
+			usage(argv[0]);
+		if (!read_file(input_path, dump)) {
+			std::perror(input_path);
+			return 1;
+		}
+		return write_json(json_path, dump) ? 0 : 1;
+	}
+
+	if (port_name == nullptr)
+		usage(argv[0]);
+
+	haptic::serial_port port;
+	if (!port.open(port_name)) {
+		std::fprintf(stderr, "can't open %s\n", port_name);
+		return 1;
+	}
+
+	port.write("r d\n", 4);
+	if (!haptic::receive_chunks(port, dump, nullptr, 5000)) {
+		std::fprintf(stderr, "timed out\n");
+		return 1;
+	}
+
+	if (clear)
+		port.write("r c\n", 4);
+
+	if (raw_path != nullptr) {
+		FILE *file = std::fopen(raw_path, "wb");
+		if (file == nullptr || std::fwrite(dump.data(), 1, dump.size(), file) != dump.size()) {
+			std::perror(raw_path);
+			return 1;
+		}
+		std::fclose(file);
+	}
+
+	if (json_path != nullptr && !write_json(json_path, dump)) {
+		std::perror(json_path);
+		return 1;
+	}
+
+	return 0;
+}
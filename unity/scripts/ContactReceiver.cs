@@ -3,15 +3,126 @@ using System.Collections.Generic;
 using UnityEngine;
 using UnityEngine.Events;
 
+// Fires myEvent when a "Cube" enters the trigger.
+//
+// With m_Predict, the haptic itself is scheduled ahead: the tracked
+// collider's closing speed gives a time to contact, and once that is within
+// the link latency a pulse is sent for that moment in device time. If the
+// trajectory changes before then the pulse is cancelled. The scheduled
+// pulse replaces myEvent for that contact; anything the predictor missed
+// still gets myEvent on contact.
 public class ContactReceiver : MonoBehaviour
 {
+	static uint s_NextId = 1;
+
+	const float k_SpeedSmoothing = 0.5f;
+	const float k_MinSpeed = 0.01f;		// m/s
+	const long  k_CancelSlackUs = 20000;
+
 	public UnityEvent myEvent;
 
+	public bool     m_Predict = false;
+	public rfcomm   m_Rfcomm;
+	public Collider m_Tracked;
+	public int      m_PulseMs = 30;
+
+	private Collider m_Trigger;
+	private float    m_LastDistance = -1;
+	private float    m_Speed = 0;
+	private bool     m_Armed = false;
+	private uint     m_ArmedId = 0;
+	private long     m_ArmedAtUs = 0;
+	private bool     m_Inside = false;
+
+	void Start()
+	{
+		m_Trigger = GetComponent<Collider>();
+	}
+
+	void FixedUpdate()
+	{
+		if (!m_Predict || m_Rfcomm == null || m_Tracked == null || m_Trigger == null)
+			return;
+
+		float distance = Distance();
+		if (m_LastDistance < 0) {
+			m_LastDistance = distance;
+			return;
+		}
+
+		float speed = (m_LastDistance - distance) / Time.fixedDeltaTime;
+		m_Speed += k_SpeedSmoothing * (speed - m_Speed);
+		m_LastDistance = distance;
+
+		if (m_Inside)
+			return;
+
+		long now = SerialConnection.NowUs();
+		long lead = m_Rfcomm.LeadUs();
+		if (lead < 0 || m_Speed < k_MinSpeed) {
+			Disarm();
+			return;
+		}
+
+		long contact = now + (long)(distance / m_Speed * 1e6f);
+
+		if (m_Armed) {
+			// Moved away, or now well off the time already sent
+			if (System.Math.Abs(contact - m_ArmedAtUs) > k_CancelSlackUs)
+				Disarm();
+			else
+				return;
+		}
+
+		if (contact - now > lead)
+			return;
+
+		uint id = s_NextId++;
+		if (m_Rfcomm.Schedule(id, contact, m_PulseMs)) {
+			m_Armed = true;
+			m_ArmedId = id;
+			m_ArmedAtUs = contact;
+		}
+	}
+
 	void OnTriggerEnter(Collider otherer)
 	{
 		if (otherer.CompareTag("Cube"))
 		{
+			if (m_Predict && m_Rfcomm != null && otherer == m_Tracked) {
+				m_Inside = true;
+				bool handled = m_Armed;
+				m_Armed = false;
+
+				// myEvent is the haptic send, it would be felt a second time
+				if (handled)
+					return;
+			}
 			this.myEvent.Invoke();
 		}
 	}
+
+	void OnTriggerExit(Collider otherer)
+	{
+		if (otherer == m_Tracked)
+			m_Inside = false;
+	}
+
+	private float Distance()
+	{
+		Vector3 a = m_Trigger.ClosestPoint(m_Tracked.bounds.center);
+		Vector3 b = m_Tracked.ClosestPoint(a);
+		return Vector3.Distance(a, b);
+	}
+
+	private void Disarm()
+	{
+		if (!m_Armed)
+			return;
+
+		// Too late to take it back once it should have started
+		if (SerialConnection.NowUs() < m_ArmedAtUs)
+			m_Rfcomm.Cancel(m_ArmedId);
+		m_Armed = false;
+	}
 }
@@ -0,0 +1,440 @@
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO.Ports;
+using System.Text;
+using System.Threading;
+using UnityEngine;
+
+// Owns one serial port on a background thread. Unity only ever appends
+// text to the current frame; EndFrame() hands the whole frame over as a
+// single write. Opening, scanning and writing never run on the main thread.
+//
+// The thread also pings the bracelet ("p <token>" -> "P <token> <device us>")
+// to track the round trip and the offset between the host and device clocks,
+// which scheduled pulses ("s <id> <device us> <ms>") rely on. With acks
+// requested it also keeps the recent pulse onsets ("A <id> <device us> <ms>"),
+// in host time.
+public class SerialConnection {
+	static Dictionary<string, SerialConnection> s_Connections = new Dictionary<string, SerialConnection>();
+	static Stopwatch s_Clock = Stopwatch.StartNew();
+
+	const int k_ReconnectMs = 500;
+	const int k_WriteTimeoutMs = 500;
+	const int k_PollMs = 2;
+	const long k_PingPeriodUs = 250000;
+	const long k_ProbeTimeoutUs = 300000;
+	const int k_SyncWindow = 8;
+	const int k_RttWindow = 64;
+	const int k_AckWindow = 256;
+
+	// FirstAckUs(): acks from then on were overwritten, the onset is unknown
+	public const long k_AckLost = -2;
+
+	public struct Ack {
+		public uint id;
+		public long hostUs;
+		public int  ms;
+	}
+
+	private string          m_RequestedPort;
+	private volatile string m_LastGoodPort;
+	private volatile bool   m_IsOpen = false;
+	private volatile bool   m_Running = true;
+	private volatile bool   m_AcksWanted = false;
+	private bool            m_AcksSent = false;	// I/O thread
+
+	private StringBuilder             m_Frame = new StringBuilder();
+	private int                       m_FrameNumber = -1;
+	private ConcurrentQueue<string>   m_Pending = new ConcurrentQueue<string>();
+	private AutoResetEvent            m_Wake = new AutoResetEvent(false);
+	private Thread                    m_Thread;
+	private SerialPort                m_Port;
+
+	// I/O thread
+	private StringBuilder m_Input = new StringBuilder();
+	private byte[]        m_ReadBuffer = new byte[256];
+	private uint          m_PingToken = 0;
+	private long[]        m_PingSent = new long[16];
+	private long          m_PingNext = 0;
+	private bool          m_PingAnswered = false;
+
+	// Shared, under m_SyncLock
+	private object m_SyncLock = new object();
+	private long[] m_SyncRtt = new long[k_SyncWindow];
+	private long[] m_SyncOffset = new long[k_SyncWindow];
+	private int    m_SyncCount = 0;
+	private int    m_SyncNext = 0;
+	private long   m_Offset = 0;
+	private long[] m_Rtt = new long[k_RttWindow];
+	private int    m_RttCount = 0;
+	private int    m_RttNext = 0;
+	private Ack[]  m_Acks = new Ack[k_AckWindow];
+	private int    m_AckCount = 0;
+	private int    m_AckNext = 0;
+
+	// One connection per port name ("" scans), shared by every rfcomm
+	public static SerialConnection Get(string portName, string lastGoodPort)
+	{
+		lock (s_Connections) {
+			SerialConnection connection;
+			if (!s_Connections.TryGetValue(portName, out connection)) {
+				connection = new SerialConnection(portName, lastGoodPort);
+				s_Connections[portName] = connection;
+			}
+			return connection;
+		}
+	}
+
+	public static void CloseAll()
+	{
+		lock (s_Connections) {
+			foreach (var connection in s_Connections.Values)
+				connection.Stop();
+			s_Connections.Clear();
+		}
+	}
+
+	public bool   IsOpen       { get { return m_IsOpen; } }
+	public string LastGoodPort { get { return m_LastGoodPort; } }
+
+	// Monotonic host clock, in microseconds
+	public static long NowUs()
+	{
+		return s_Clock.ElapsedTicks * 1000000 / Stopwatch.Frequency;
+	}
+
+	public bool IsSynced
+	{
+		get { lock (m_SyncLock) { return m_SyncCount > 0; } }
+	}
+
+	// Device time at a host time, -1 until the first ping is answered
+	public long DeviceTimeUs(long hostUs)
+	{
+		lock (m_SyncLock) {
+			if (m_SyncCount == 0)
+				return -1;
+			return hostUs + m_Offset;
+		}
+	}
+
+	// Worst recent round trip, -1 without samples
+	public long RttMaxUs()
+	{
+		lock (m_SyncLock) {
+			if (m_RttCount == 0)
+				return -1;
+
+			long max = 0;
+			for (int i = 0; i < m_RttCount; i++)
+				max = Math.Max(max, m_Rtt[i]);
+			return max;
+		}
+	}
+
+	// Ask the bracelet to report every pulse it starts
+	public void RequestAcks()
+	{
+		m_AcksWanted = true;
+		m_Wake.Set();
+	}
+
+	// Earliest pulse onset in [fromUs, toUs) host time, -1 if none is known,
+	// k_AckLost if the window no longer reaches back to fromUs
+	public long FirstAckUs(long fromUs, long toUs)
+	{
+		lock (m_SyncLock) {
+			// Full, the oldest kept is where m_AckNext writes next
+			if (m_AckCount == k_AckWindow && m_Acks[m_AckNext].hostUs > fromUs)
+				return k_AckLost;
+
+			long first = -1;
+			for (int i = 0; i < m_AckCount; i++) {
+				long at = m_Acks[i].hostUs;
+				if (at < fromUs || at >= toUs)
+					continue;
+				if (first < 0 || at < first)
+					first = at;
+			}
+			return first;
+		}
+	}
+
+	private SerialConnection(string portName, string lastGoodPort)
+	{
+		m_RequestedPort = portName;
+		m_LastGoodPort  = lastGoodPort;
+
+		m_Thread = new Thread(Run);
+		m_Thread.IsBackground = true;
+		m_Thread.Name = "SerialConnection " + portName;
+		m_Thread.Start();
+	}
+
+	// Main thread: add a line to this frame's write
+	public void Enqueue(string message)
+	{
+		if (m_FrameNumber != Time.frameCount) {
+			EndFrame();
+			m_FrameNumber = Time.frameCount;
+		}
+		m_Frame.Append(message);
+		m_Frame.Append('\n');
+	}
+
+	// Main thread: hand this frame's lines to the I/O thread
+	public void EndFrame()
+	{
+		if (m_Frame.Length == 0)
+			return;
+
+		m_Pending.Enqueue(m_Frame.ToString());
+		m_Frame.Length = 0;
+		m_Wake.Set();
+	}
+
+	// Main thread: a pulse at a host time, translated to the device clock
+	public bool Schedule(uint id, long hostUs, int ms)
+	{
+		long deviceUs = DeviceTimeUs(hostUs);
+		if (deviceUs < 0)
+			return false;
+
+		Enqueue("s " + id + " " + deviceUs + " " + ms);
+		return true;
+	}
+
+	// Main thread: drop a scheduled pulse that hasn't started yet
+	public void Cancel(uint id)
+	{
+		Enqueue("c " + id);
+	}
+
+	public void Stop()
+	{
+		m_Running = false;
+		m_Wake.Set();
+		m_Thread.Join(1000);
+	}
+
+	private void Run()
+	{
+		while (m_Running) {
+			if (m_Port == null || !m_Port.IsOpen) {
+				m_IsOpen = false;
+
+				// Stale haptics are worse than none
+				string dropped;
+				while (m_Pending.TryDequeue(out dropped)) {
+				}
+
+				if (!Connect()) {
+					m_Wake.WaitOne(k_ReconnectMs);
+					continue;
+				}
+				m_IsOpen = true;
+				m_PingNext = NowUs();
+				m_Input.Length = 0;
+				m_AcksSent = false;
+			}
+
+			m_Wake.WaitOne(k_PollMs);
+
+			string batch;
+			StringBuilder write = new StringBuilder();
+			while (m_Pending.TryDequeue(out batch))
+				write.Append(batch);
+
+			if (m_AcksWanted && !m_AcksSent) {
+				write.Append("a 1\n");
+				m_AcksSent = true;
+			}
+
+			long now = NowUs();
+			if (now >= m_PingNext) {
+				m_PingNext = now + k_PingPeriodUs;
+				write.Append(NextPing(now));
+			}
+
+			try {
+				if (write.Length > 0)
+					m_Port.Write(write.ToString());
+				Receive();
+			} catch {
+				Close();
+			}
+		}
+		Close();
+	}
+
+	private string NextPing(long now)
+	{
+		m_PingToken++;
+		m_PingSent[m_PingToken % m_PingSent.Length] = now;
+		return "p " + m_PingToken + "\n";
+	}
+
+	private void Receive()
+	{
+		int available = m_Port.BytesToRead;
+		while (available > 0) {
+			int length = m_Port.Read(m_ReadBuffer, 0, Math.Min(available, m_ReadBuffer.Length));
+			for (int i = 0; i < length; i++) {
+				char c = (char)m_ReadBuffer[i];
+				if (c != '\n' && c != '\r') {
+					if (m_Input.Length < 256)
+						m_Input.Append(c);
+					continue;
+				}
+				if (m_Input.Length > 0)
+					ParseLine(m_Input.ToString());
+				m_Input.Length = 0;
+			}
+			available -= length;
+		}
+	}
+
+	private void ParseLine(string line)
+	{
+		long received = NowUs();
+		string[] parts = line.Split(' ');
+		if (parts.Length == 4 && parts[0] == "A") {
+			ParseAck(parts);
+			return;
+		}
+		if (parts.Length != 3 || parts[0] != "P")
+			return;
+
+		uint token;
+		long device;
+		if (!uint.TryParse(parts[1], out token) || !long.TryParse(parts[2], out device))
+			return;
+
+		// Too old, the slot has been reused
+		if (token > m_PingToken || m_PingToken - token >= m_PingSent.Length)
+			return;
+
+		long sent = m_PingSent[token % m_PingSent.Length];
+		long rtt = received - sent;
+		m_PingAnswered = true;
+
+		lock (m_SyncLock) {
+			m_Rtt[m_RttNext] = rtt;
+			m_RttNext = (m_RttNext + 1) % k_RttWindow;
+			m_RttCount = Math.Min(m_RttCount + 1, k_RttWindow);
+
+			// The sample with the lowest round trip is the least disturbed one
+			m_SyncRtt[m_SyncNext] = rtt;
+			m_SyncOffset[m_SyncNext] = device - (sent + received) / 2;
+			m_SyncNext = (m_SyncNext + 1) % k_SyncWindow;
+			m_SyncCount = Math.Min(m_SyncCount + 1, k_SyncWindow);
+
+			int best = 0;
+			for (int i = 1; i < m_SyncCount; i++) {
+				if (m_SyncRtt[i] < m_SyncRtt[best])
+					best = i;
+			}
+			m_Offset = m_SyncOffset[best];
+		}
+	}
+
+	private void ParseAck(string[] parts)
+	{
+		uint id;
+		long device;
+		int ms;
+		if (!uint.TryParse(parts[1], out id) || !long.TryParse(parts[2], out device) || !int.TryParse(parts[3], out ms))
+			return;
+
+		lock (m_SyncLock) {
+			// Can't place it in host time yet
+			if (m_SyncCount == 0)
+				return;
+
+			m_Acks[m_AckNext].id     = id;
+			m_Acks[m_AckNext].hostUs = device - m_Offset;
+			m_Acks[m_AckNext].ms     = ms;
+			m_AckNext = (m_AckNext + 1) % k_AckWindow;
+			m_AckCount = Math.Min(m_AckCount + 1, k_AckWindow);
+		}
+	}
+
+	private bool Connect()
+	{
+		if (m_RequestedPort != "")
+			return TryPort(m_RequestedPort, false);
+
+		// Last port that worked first, then every port
+		if (!string.IsNullOrEmpty(m_LastGoodPort) && TryPort(m_LastGoodPort, true))
+			return true;
+
+		foreach (string port in SerialPort.GetPortNames()) {
+			if (!m_Running)
+				return false;
+			if (port == m_LastGoodPort)
+				continue;
+			if (TryPort(port, true))
+				return true;
+		}
+		return false;
+	}
+
+	// Scanning, only a port that answers a ping is a bracelet
+	private bool TryPort(string portName, bool requireReply)
+	{
+		SerialPort port = new SerialPort(portName);
+		port.BaudRate     = 9600;
+		port.Parity       = Parity.None;
+		port.DataBits     = 8;
+		port.StopBits     = StopBits.One;
+		port.WriteTimeout = k_WriteTimeoutMs;
+		try {
+			port.Open();
+		} catch {
+			port.Close();
+			return false;
+		}
+
+		m_Port = port;
+		m_Input.Length = 0;
+		if (requireReply && !Probe()) {
+			Close();
+			return false;
+		}
+
+		m_LastGoodPort = portName;
+		return true;
+	}
+
+	private bool Probe()
+	{
+		m_PingAnswered = false;
+		try {
+			m_Port.Write(NextPing(NowUs()));
+
+			long until = NowUs() + k_ProbeTimeoutUs;
+			while (!m_PingAnswered && NowUs() < until && m_Running) {
+				Thread.Sleep(k_PollMs);
+				Receive();
+			}
+		} catch {
+			return false;
+		}
+		return m_PingAnswered;
+	}
+
+	private void Close()
+	{
+		m_IsOpen = false;
+		if (m_Port == null)
+			return;
+
+		try {
+			m_Port.Close();
+		} catch {
+		}
+		m_Port = null;
+	}
+}
@@ -15,6 +15,16 @@ namespace UnityEngine.UI {
 		public int targetValue;
 
 		public UnityEvent m_SelectedEvent;
+
+		// Detent clicks rendered by the bracelet: the position is streamed
+		// at m_StreamHz and the device times each notch by itself.
+		public rfcomm m_Rfcomm;
+		public bool   m_StreamDetents = false;
+		public float  m_DetentSpacing = 1;
+		public float  m_StreamHz = 30;
+
+		private float m_LastStreamTime = -1;
+		private int   m_LastStreamed = int.MinValue;
 	
 		// Start is called before the first frame update
 		void Start()
@@ -25,6 +35,8 @@ namespace UnityEngine.UI {
 		// Update is called once per frame
 		void Update()
 		{
+			StreamDetents();
+
 			if (myEvent == null)
 				return;
 
@@ -51,5 +63,32 @@ namespace UnityEngine.UI {
 			m_Selected = true;
 		}
 
+		void OnDisable()
+		{
+			if (m_Rfcomm != null && m_LastStreamed != int.MinValue)
+				m_Rfcomm.Send("d 0 0");
+			m_LastStreamed = int.MinValue;
+		}
+
+		private void StreamDetents()
+		{
+			if (!m_StreamDetents || m_Rfcomm == null || m_DetentSpacing <= 0)
+				return;
+
+			// Thousandths, the firmware works in integers
+			int position = Mathf.RoundToInt(mySlider.value * 1000);
+			if (position == m_LastStreamed)
+				return;
+
+			float now = Time.unscaledTime;
+			if (now - m_LastStreamTime < 1 / m_StreamHz)
+				return;
+
+			int spacing = Mathf.RoundToInt(m_DetentSpacing * 1000);
+			m_Rfcomm.Send("d " + spacing + " " + position);
+			m_LastStreamed = position;
+			m_LastStreamTime = now;
+		}
+
 	}
 }
\ No newline at end of file
@@ -4,21 +4,47 @@ using UnityEngine;
 using System.Text;
 using System.IO;
 using System;
+using System.Threading;
 using UnityEngine.Events;
 
+// Times selection and positioning on the monotonic clock shared with
+// SerialConnection. Trials are kept in memory and written to the CSV in the
+// background once the block is done, so no file I/O happens mid trial.
+//
+// With m_Rfcomm set, the bracelet acknowledges every pulse and the first
+// haptic onset of each trial is written too, in seconds from the start.
+// It is looked up shortly after each trial, while the connection still
+// keeps its acks; "lost" if it didn't.
 public class Timer : MonoBehaviour
 {
-	private System.DateTime m_StartTime;
-	private Boolean         m_IsRunning  = false; // the timer is running
-	private System.DateTime m_SelectionTime;
-	private List<double>    m_Data       = new List<double>();
-	private String          m_FilePath;
-	private GameObject      m_UserIdGameObject;
+	// Give the last pulse ack time to come back before writing
+	const int k_AckWaitMs = 500;
+
+	private struct Trial {
+		public long startUs;
+		public long selectionUs;
+		public long stopUs;
+		public long onsetUs;
+		public bool resolved;
+	}
+
+	private long             m_StartUs;
+	private Boolean          m_IsRunning  = false; // the timer is running
+	private long             m_SelectionUs;
+	private Trial[]          m_Trials;
+	private int              m_Count = 0;
+	private int              m_Written = 0;
+	private int              m_Resolved = 0;
+	private String           m_FilePath;
+	private GameObject       m_UserIdGameObject;
+	private SerialConnection m_Connection;
+	private object           m_FileLock = new object();
 
 
 	public int              m_Iterations;
 	public String           m_DataLabel;
 	public UnityEvent       m_Event;
+	public rfcomm           m_Rfcomm;
 
 	void Start()
 	{
@@ -28,11 +54,25 @@ public class Timer : MonoBehaviour
 		writer.Close();
 
 		m_UserIdGameObject = GameObject.Find("ExperimentControls");
+		m_Trials = new Trial[Math.Max(m_Iterations, 1)];
+
+		if (m_Rfcomm != null)
+			m_Connection = m_Rfcomm.RequestAcks();
+	}
+
+	void Update()
+	{
+		// Onsets of the trials whose last ack has had time to come back
+		long now = SerialConnection.NowUs();
+		while (m_Resolved < m_Count && now - m_Trials[m_Resolved].stopUs >= k_AckWaitMs * 1000L) {
+			Resolve(ref m_Trials[m_Resolved], m_Connection);
+			m_Resolved++;
+		}
 	}
 
 	public void StartTimer()
 	{
-		m_StartTime = DateTime.Now;
+		m_StartUs = SerialConnection.NowUs();
 		m_IsRunning = true;
 		Debug.Log("Timer Started");
 	}
@@ -42,7 +82,7 @@ public class Timer : MonoBehaviour
 		if (m_IsRunning == false)
 			return;
 
-		m_SelectionTime = DateTime.Now;
+		m_SelectionUs = SerialConnection.NowUs();
 		Debug.Log("Timer Selected");
 	}
 
@@ -51,19 +91,21 @@ public class Timer : MonoBehaviour
 		if (m_IsRunning == false)
 			return;
 
+		long now = SerialConnection.NowUs();
 
-		if (m_Data.Count < m_Iterations) {
-			double selectionSeconds = (m_SelectionTime - m_StartTime).TotalSeconds;
-			double positioningSeconds = (DateTime.Now - m_SelectionTime).TotalSeconds;
+		if (m_Count < m_Iterations) {
+			m_Trials[m_Count].startUs     = m_StartUs;
+			m_Trials[m_Count].selectionUs = m_SelectionUs;
+			m_Trials[m_Count].stopUs      = now;
+			m_Trials[m_Count].resolved    = false;
+			m_Count++;
 
-			m_Data.Add(positioningSeconds);
-			StreamWriter writer = new StreamWriter(m_FilePath, true, Encoding.ASCII);
-			writer.WriteLine((m_UserIdGameObject.GetComponent<UserID>()).userID + "," + selectionSeconds + "," + positioningSeconds);
-			writer.Close();
+			if (m_Count >= m_Iterations)
+				Flush(true);
 		}
 
 
-		if (m_Data.Count >= m_Iterations && m_Event != null)
+		if (m_Count >= m_Iterations && m_Event != null)
 			m_Event.Invoke();
 
 		m_IsRunning = false;
@@ -72,6 +114,81 @@ public class Timer : MonoBehaviour
 
 	public void ResetData()
 	{
-		m_Data.Clear();
+		Flush(true);
+		m_Count = 0;
+		m_Written = 0;
+		m_Resolved = 0;
+	}
+
+	void OnApplicationQuit()
+	{
+		// Last chance, write what's left right away
+		Flush(false);
+	}
+
+	// Hand the trials not written yet to a worker thread
+	private void Flush(bool background)
+	{
+		if (m_Written >= m_Count)
+			return;
+
+		Trial[] trials = new Trial[m_Count - m_Written];
+		Array.Copy(m_Trials, m_Written, trials, 0, trials.Length);
+		m_Written = m_Count;
+
+		string userId = (m_UserIdGameObject.GetComponent<UserID>()).userID;
+		SerialConnection connection = m_Connection;
+
+		if (!background) {
+			Write(trials, userId, connection);
+			return;
+		}
+
+		ThreadPool.QueueUserWorkItem(state => {
+			// The last trials, still waiting for their acks
+			if (connection != null && Array.Exists(trials, trial => !trial.resolved))
+				Thread.Sleep(k_AckWaitMs);
+			Write(trials, userId, connection);
+		});
+	}
+
+	private static void Resolve(ref Trial trial, SerialConnection connection)
+	{
+		if (trial.resolved)
+			return;
+
+		trial.onsetUs  = (connection != null) ? connection.FirstAckUs(trial.startUs, trial.stopUs) : -1;
+		trial.resolved = true;
+	}
+
+	private void Write(Trial[] trials, string userId, SerialConnection connection)
+	{
+		StringBuilder text = new StringBuilder();
+		for (int i = 0; i < trials.Length; i++) {
+			Resolve(ref trials[i], connection);
+			Trial trial = trials[i];
+
+			double selectionSeconds   = (trial.selectionUs - trial.startUs) / 1e6;
+			double positioningSeconds = (trial.stopUs - trial.selectionUs) / 1e6;
+
+			text.Append(userId + "," + selectionSeconds + "," + positioningSeconds);
+			if (connection != null) {
+				text.Append(',');
+				if (trial.onsetUs >= 0)
+					text.Append((trial.onsetUs - trial.startUs) / 1e6);
+				else if (trial.onsetUs == SerialConnection.k_AckLost)
+					text.Append("lost");
+			}
+			text.Append('\n');
+		}
+
+		// One block at a time
+		lock (m_FileLock) {
+			try {
+				File.AppendAllText(m_FilePath, text.ToString(), Encoding.ASCII);
+			} catch (Exception e) {
+				Debug.LogError("Timer: writing " + m_FilePath + " failed: " + e.Message);
+			}
+		}
 	}
 }
@@ -1,13 +1,13 @@
 using System.Collections;
 using System.Collections.Generic;
-using System.IO.Ports;
 using UnityEngine;
 
 public class rfcomm : MonoBehaviour {
-	static SerialPort sp = new SerialPort();
-	static int port_l    = 0;
-	static int port_u    = 10;
-	
+	const string k_LastPortKey = "rfcomm.lastPort";
+
+	private SerialConnection m_Connection;
+	private string           m_SavedPort;
+
 	public string m_SerialPortName = "";
 	public string message_write;
 	public bool   send    = false;
@@ -15,11 +15,8 @@ public class rfcomm : MonoBehaviour {
 
 	void Start()
 	{
-		sp.BaudRate     = 9600;
-		sp.Parity       = Parity.None;
-		sp.DataBits     = 8;
-		sp.StopBits     = StopBits.One;
-		sp.WriteTimeout = 5000;
+		m_SavedPort = PlayerPrefs.GetString(k_LastPortKey, "");
+		OpenConnection();
 	}
 
 	void Update()
@@ -34,63 +31,85 @@ public class rfcomm : MonoBehaviour {
 		}
 	}
 
+	// Everything sent during this frame goes out as one write
+	void LateUpdate()
+	{
+		if (m_Connection == null)
+			return;
+
+		m_Connection.EndFrame();
+
+		string port = m_Connection.LastGoodPort;
+		if (!string.IsNullOrEmpty(port) && port != m_SavedPort)
+		{
+			m_SavedPort = port;
+			PlayerPrefs.SetString(k_LastPortKey, port);
+		}
+	}
+
+	// Never blocks: queued for the end of the frame, written in the background
 	public void Send(string message)
 	{
 		if (disable)
 			return;
 
 		OpenConnection();
-		sp.WriteLine(message);
+		m_Connection.Enqueue(message);
 	}
 
-	public void OpenConnection()
+	// A pulse at a host time (SerialConnection.NowUs()), false until the
+	// bracelet's clock is known
+	public bool Schedule(uint id, long hostUs, int ms)
 	{
 		if (disable)
-			return;
+			return false;
 
-		if (sp == null)
-		{
-			Debug.Log("Port == null");
-			return;
-		}
+		OpenConnection();
+		return m_Connection.Schedule(id, hostUs, ms);
+	}
 
-		if (sp.IsOpen)
-		{
-			Debug.Log("Port is Open");
+	public void Cancel(uint id)
+	{
+		if (disable || m_Connection == null)
 			return;
-		}
 
-		if (m_SerialPortName != "")
-		{
-			if (tryPort(m_SerialPortName) == 0)
-				return;
-		}
+		m_Connection.Cancel(id);
+	}
 
+	// How far ahead a scheduled pulse has to be sent, -1 while unknown
+	public long LeadUs()
+	{
+		if (disable || m_Connection == null || !m_Connection.IsSynced)
+			return -1;
 
-		var m_PortNames = SerialPort.GetPortNames();
-		foreach(string port in m_PortNames)
-		{
-			if (tryPort(port) == 0)
-				return;
-		}
+		// A command needs half a round trip, plus one device tick
+		return m_Connection.RttMaxUs() / 2 + 1000;
 	}
-	
-	private int tryPort(string portName)
-	{		
-		sp.PortName = portName;
-		try {
-			sp.WriteTimeout = 5000;
-			sp.Open();
-			sp.WriteLine("0 0");
-		} catch {
-			sp.Close();
-			return 1;
-		}
-		return 0;
+
+	// Pulse onsets reported by the bracelet, see SerialConnection.FirstAckUs
+	public SerialConnection RequestAcks()
+	{
+		if (disable)
+			return null;
+
+		OpenConnection();
+		m_Connection.RequestAcks();
+		return m_Connection;
+	}
+
+	public void OpenConnection()
+	{
+		if (disable)
+			return;
+
+		if (m_Connection != null)
+			return;
+
+		m_Connection = SerialConnection.Get(m_SerialPortName, m_SavedPort);
 	}
 
 	void OnApplicationQuit() {
-		sp.Close();
+		SerialConnection.CloseAll();
 	}
 
 }